@@ -3,7 +3,11 @@
 #include <string.h>
 #include <unistd.h>
 #include <errno.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stddef.h>
 #include <sys/socket.h>
+#include <sys/un.h>
 #include <sys/time.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
@@ -14,6 +18,11 @@
 // 引入日志和监控模块
 #include "logger.h"
 #include "monitor.h"
+#include "frame.h"
+
+#ifdef ENABLE_TLS
+#include "tls_session.h"
+#endif
 
 #define SERVER_IP "127.0.0.1"
 #define SERVER_PORT 8888
@@ -24,6 +33,14 @@
 #define DEFAULT_SIZE 64
 #define DEFAULT_QPS 0
 #define DEFAULT_DURATION 0
+#define MAX_SIZE (1024 * 1024)  // 大消息压测 (配合服务端 -e stream)
+#define DEFAULT_PIPELINE 1
+#define MAX_PIPELINE 64
+#define MAX_PIPELINE_BYTES (256 * 1024)  // 一批在途数据的上限，避免两端 socket 缓冲区同时写满而互相阻塞
+#define LATENCY_BUCKETS 100000           // 往返延迟直方图: 1us 一档，覆盖 0-100ms，更慢的计入最后一档
+#define UDP_HEADER_SIZE 16               // UDP 模式每个数据报开头: 序号 (8 字节) + 发送时间 (8 字节)
+#define MAX_UDP_SIZE 65507
+#define DEFAULT_UDP_TIMEOUT_MS 100       // 一批数据报发出后等待回显的时长，超时未到的先记为丢失
 
 // 全局 Logger 实例
 static Logger *g_logger = NULL;
@@ -35,31 +52,129 @@ typedef struct {
     int send_size;
     int qps_limit;
     int duration_sec;
+    int pipeline;  // 每批连续发送的消息数，收齐全部回显后再发下一批
+    int udp;       // UDP 模式: 每个"连接"是一个 connect 过的 UDP socket，按序号统计丢包与乱序
+    int udp_timeout_ms;
+    const char *unix_path;  // 非 NULL 时经 AF_UNIX 流式 socket 连接服务端 (服务端需 --unix)，以 @ 开头为抽象命名空间
+    int tls;                // TLS 1.3 (client_tls 版本): 0 关闭, 1 kTLS, 2 用户态 SSL_read/SSL_write
+    int framed;             // 长度前缀帧协议 (服务端 -e framed): 每条消息带帧头，一批帧一次写出，按帧统计延迟
 } ClientConfig;
 
+static const char *TLS_MODE_NAMES[] = {"off", "ktls", "user"};
+
+// UDP 模式统计。数据报超时未到时先不重传，之后到达的仍计入 received (同时计入 late)
+typedef struct {
+    long long sent;
+    long long received;
+    long long reordered;  // 序号小于此前已收到的最大序号
+    long long late;       // 在所属批次的等待超时之后才到达
+} UdpStats;
+
+// 往返延迟直方图 (每批 pipeline 条消息记一次；UDP 与 framed 模式按每条消息记录)
+static long long g_latency_hist[LATENCY_BUCKETS];
+static long long g_latency_count = 0;
+static long long g_latency_max = 0;
+
+static void latency_record(long long us) {
+    if (us > g_latency_max)
+        g_latency_max = us;
+    g_latency_hist[us < LATENCY_BUCKETS ? us : LATENCY_BUCKETS - 1]++;
+    g_latency_count++;
+}
+
+// 第 q 分位 (0-1) 所在档位的微秒数
+static long long latency_percentile(double q) {
+    long long target = (long long)(q * g_latency_count + 0.5);
+    if (target < 1)
+        target = 1;
+    long long seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += g_latency_hist[i];
+        if (seen >= target)
+            return i == LATENCY_BUCKETS - 1 ? g_latency_max : i;
+    }
+    return g_latency_max;
+}
+
 void print_usage(const char *prog) {
     printf("用法: %s [选项]\n\n", prog);
     printf("选项:\n");
     printf("  -c, --connections NUM   并发连接数 (默认: %d)\n", DEFAULT_CONNECTIONS);
     printf("  -r, --rounds NUM        测试轮次 (默认: %d, 0=基于时长)\n", DEFAULT_ROUNDS);
-    printf("  -s, --size NUM          发送数据大小(字节) (默认: %d)\n", DEFAULT_SIZE);
+    printf("  -s, --size NUM          发送数据大小(字节) (默认: %d, 最大: %d)\n", DEFAULT_SIZE, MAX_SIZE);
     printf("  -q, --qps NUM           QPS 限制 (默认: %d, 0=不限制)\n", DEFAULT_QPS);
     printf("  -d, --duration SEC      测试时长(秒) (默认: %d, 0=基于轮次)\n", DEFAULT_DURATION);
+    printf("  -p, --pipeline NUM      每连接连续发送 NUM 条消息后再统一接收回显 (默认: %d, 最大: %d)\n",
+           DEFAULT_PIPELINE, MAX_PIPELINE);
+    printf("  -u, --udp               UDP 模式 (服务端需 --udp): 统计丢包、乱序，数据大小 %d-%d 字节\n", UDP_HEADER_SIZE,
+           MAX_UDP_SIZE);
+    printf("      --udp-timeout MS    UDP 模式每批等待回显的时长 (默认: %d)\n", DEFAULT_UDP_TIMEOUT_MS);
+    printf("      --unix PATH         经 Unix 域 socket 连接 (服务端需 --unix PATH)，@name 为抽象命名空间\n");
+    printf("      --framed            帧协议 (服务端需 -e framed): 16 字节帧头 + NUM 字节载荷，按帧统计往返延迟\n");
+    printf("      --tls MODE          TLS 1.3 (client_tls 版本，服务端需 --tls): ktls=密钥装入内核, user=用户态加解密\n");
     printf("  -h, --help              显示此帮助信息\n\n");
     printf("示例:\n");
     printf("  %s                                    # 默认配置\n", prog);
     printf("  %s -c 20 -r 200000                    # 20连接, 20万轮\n", prog);
     printf("  %s -q 50000 -d 60                     # 限制5万QPS, 运行60秒\n", prog);
     printf("  %s -c 10 -q 30000 -d 120              # 10连接, 3万QPS, 2分钟\n", prog);
+    printf("  %s -c 10 -p 8 -d 30                   # 每连接 8 条消息流水线发送\n", prog);
+    printf("  %s -u -c 8 -p 32 -d 30                # UDP: 8 个 socket，每批 32 个数据报\n", prog);
+    printf("  %s --unix @echo -c 8 -d 30            # 与 TCP 回环对比本机 IPC 开销\n", prog);
+    printf("  %s --framed -c 8 -p 16 -d 30          # 每批 16 帧一次写出，统计每帧延迟\n", prog);
+    printf("  ./out/client_tls --tls ktls -c 8 -d 30      # TLS 1.3 回显 (服务端 server_tls --tls ktls)\n");
     printf("\n");
 }
 
 struct connection {
     int fd;          // socket 文件描述符
     char *send_buf;  // 发送缓冲区（动态分配）
-    char *recv_buf;  // 接收缓冲区（动态分配）
+    char *recv_buf;  // 接收缓冲区（动态分配，pipeline 条消息）
+    uint64_t next_seq;  // UDP / framed 模式: 下一个发送序号
+    uint64_t max_seen;  // UDP 模式: 已收到的最大序号 + 1
+#ifdef ENABLE_TLS
+    SSL *ssl;           // --tls user 模式的会话，kTLS 与明文连接为 NULL
+#endif
 };
 
+// 收发走 SSL (用户态 TLS) 或直接读写 fd (明文 / kTLS)
+static ssize_t conn_write(struct connection *conn, const void *buf, size_t len) {
+#ifdef ENABLE_TLS
+    if (conn->ssl) {
+        size_t n;
+        if (SSL_write_ex(conn->ssl, buf, len, &n) == 1)
+            return n;
+        errno = EIO;
+        return -1;
+    }
+#endif
+    return write(conn->fd, buf, len);
+}
+
+static ssize_t conn_read(struct connection *conn, void *buf, size_t len) {
+#ifdef ENABLE_TLS
+    if (conn->ssl) {
+        size_t n;
+        if (SSL_read_ex(conn->ssl, buf, len, &n) == 1)
+            return n;
+        if (SSL_get_error(conn->ssl, 0) == SSL_ERROR_ZERO_RETURN)
+            return 0;
+        errno = EIO;
+        return -1;
+    }
+#endif
+    return read(conn->fd, buf, len);
+}
+
+static void conn_close(struct connection *conn) {
+#ifdef ENABLE_TLS
+    if (conn->ssl)
+        SSL_free(conn->ssl);
+    conn->ssl = NULL;
+#endif
+    close(conn->fd);
+}
+
 // 设置 TCP_NODELAY（禁用 Nagle 算法，减少延迟）
 int set_nodelay(int fd) {
     int opt = 1;
@@ -72,29 +187,35 @@ int set_nodelay(int fd) {
     return 0;
 }
 
-// 功能：发送数据，接收回显，验证正确性
+// 功能：连续发送 pipeline 条消息，接收全部回显，验证正确性
 // 返回：成功返回 0，失败返回 -1
-int do_echo_test(int fd, char *send_buf, char *recv_buf, size_t size) {
-    // 1. 发送数据（循环写，确保全部发送）
-    ssize_t written = 0;
-    while (written < (ssize_t)size) {
-        ssize_t n = write(fd, send_buf + written, size - written);
-        if (n < 0) {
-            if (errno == EINTR) {
-                continue;  // 被信号中断，重试
-            }
-            if (g_logger) {
-                LOG_ERROR(g_logger, "write 失败: %s", strerror(errno));
+int do_echo_test(struct connection *conn, size_t size, int pipeline) {
+    char *send_buf = conn->send_buf;
+    char *recv_buf = conn->recv_buf;
+
+    // 1. 发送数据（每条消息单独 write，循环写，确保全部发送）
+    for (int i = 0; i < pipeline; i++) {
+        ssize_t written = 0;
+        while (written < (ssize_t)size) {
+            ssize_t n = conn_write(conn, send_buf + written, size - written);
+            if (n < 0) {
+                if (errno == EINTR) {
+                    continue;  // 被信号中断，重试
+                }
+                if (g_logger) {
+                    LOG_ERROR(g_logger, "write 失败: %s", strerror(errno));
+                }
+                return -1;
             }
-            return -1;
+            written += n;
         }
-        written += n;
     }
 
     // 2. 接收数据（循环读，确保读满）
+    size_t total = size * pipeline;
     ssize_t total_read = 0;
-    while (total_read < (ssize_t)size) {
-        ssize_t n = read(fd, recv_buf + total_read, size - total_read);
+    while (total_read < (ssize_t)total) {
+        ssize_t n = conn_read(conn, recv_buf + total_read, total - total_read);
         if (n < 0) {
             if (g_logger) {
                 LOG_ERROR(g_logger, "read 失败: %s", strerror(errno));
@@ -110,21 +231,160 @@ int do_echo_test(int fd, char *send_buf, char *recv_buf, size_t size) {
     }
 
     // 3. 验证数据一致性
-    if (memcmp(send_buf, recv_buf, size) != 0) {
-        if (g_logger) {
-            LOG_ERROR(g_logger, "数据不一致！");
+    for (int i = 0; i < pipeline; i++) {
+        if (memcmp(send_buf, recv_buf + (size_t)i * size, size) != 0) {
+            if (g_logger) {
+                LOG_ERROR(g_logger, "数据不一致！");
+            }
+            return -1;
         }
-        return -1;
     }
 
     return 0;
 }
 
-// 功能：创建一个到服务器的连接
+// framed 模式: pipeline 个帧 (帧头 + size 字节载荷) 在 send_buf 中连续排列，一次写出；
+// 每收齐一个回显帧就校验序号与载荷，并按帧头中的发送时间记录该帧的往返延迟
+// 返回：成功返回 0，失败返回 -1
+int do_framed_echo_test(struct connection *conn, size_t size, int pipeline) {
+    size_t frame = FRAME_HEADER_SIZE + size;
+    size_t total = frame * pipeline;
+    uint32_t first_seq = (uint32_t)conn->next_seq;
+    long long now = monitor_get_time_us();
+    for (int i = 0; i < pipeline; i++)
+        frame_header_write(conn->send_buf + i * frame, size, (uint32_t)conn->next_seq++, now);
+
+    size_t written = 0;
+    while (written < total) {
+        ssize_t n = conn_write(conn, conn->send_buf + written, total - written);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            LOG_ERROR(g_logger, "write 失败: %s", strerror(errno));
+            return -1;
+        }
+        written += n;
+    }
+
+    size_t total_read = 0;
+    int done = 0;
+    while (done < pipeline) {
+        ssize_t n = conn_read(conn, conn->recv_buf + total_read, total - total_read);
+        if (n < 0) {
+            LOG_ERROR(g_logger, "read 失败: %s", strerror(errno));
+            return -1;
+        } else if (n == 0) {
+            LOG_ERROR(g_logger, "连接被服务器关闭");
+            return -1;
+        }
+        total_read += n;
+        now = monitor_get_time_us();
+        for (; done < (int)(total_read / frame); done++) {
+            const char *echo = conn->recv_buf + done * frame;
+            FrameHeader hdr;
+            frame_header_read(echo, &hdr);
+            if (hdr.len != size || hdr.seq != first_seq + (uint32_t)done ||
+                memcmp(echo + FRAME_HEADER_SIZE, conn->send_buf + FRAME_HEADER_SIZE, size) != 0) {
+                LOG_ERROR(g_logger, "数据不一致！(帧 %u)", first_seq + (uint32_t)done);
+                return -1;
+            }
+            latency_record(now - (long long)hdr.sent_us);
+        }
+    }
+    return 0;
+}
+
+// UDP 模式: 接收回显直到本批 (序号 >= batch_first) 收到 want 个或到达 deadline
+// 上一批超时后才到的数据报也在这里收下，计入 late
+// 返回：本次收到的数据报数，数据不一致或服务端不可达返回 -1
+static int udp_receive(struct connection *conn, size_t size, int want, uint64_t batch_first, long long deadline,
+                       UdpStats *st) {
+    int got = 0, got_batch = 0;
+    while (got_batch < want) {
+        long long now = monitor_get_time_us();
+        if (now >= deadline)
+            break;
+        struct pollfd pfd = {.fd = conn->fd, .events = POLLIN};
+        int ready = poll(&pfd, 1, (int)((deadline - now + 999) / 1000));
+        if (ready < 0 && errno != EINTR) {
+            LOG_ERROR(g_logger, "poll 失败: %s", strerror(errno));
+            return -1;
+        }
+        if (ready <= 0)
+            continue;
+
+        ssize_t n = recv(conn->fd, conn->recv_buf, size, MSG_DONTWAIT | MSG_TRUNC);
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EINTR)
+                continue;
+            LOG_ERROR(g_logger, "recv 失败: %s", strerror(errno));
+            return -1;
+        }
+        uint64_t seq;
+        long long sent_us;
+        memcpy(&seq, conn->recv_buf, sizeof(seq));
+        memcpy(&sent_us, conn->recv_buf + sizeof(seq), sizeof(sent_us));
+        if ((size_t)n != size || seq >= conn->next_seq ||
+            memcmp(conn->recv_buf + UDP_HEADER_SIZE, conn->send_buf + UDP_HEADER_SIZE, size - UDP_HEADER_SIZE) != 0) {
+            LOG_ERROR(g_logger, "数据不一致！");
+            return -1;
+        }
+
+        latency_record(monitor_get_time_us() - sent_us);
+        st->received++;
+        got++;
+        if (seq < conn->max_seen)
+            st->reordered++;
+        else
+            conn->max_seen = seq + 1;
+        if (seq < batch_first)
+            st->late++;
+        else
+            got_batch++;
+    }
+    return got;
+}
+
+// UDP 模式: 连续发送 pipeline 个带序号的数据报，等待回显直到收齐或超时 (丢包不算失败)
+// 返回：本批收到的数据报数，失败返回 -1
+int do_udp_echo_test(struct connection *conn, size_t size, int pipeline, int timeout_ms, UdpStats *st) {
+    uint64_t batch_first = conn->next_seq;
+    for (int i = 0; i < pipeline; i++) {
+        uint64_t seq = conn->next_seq++;
+        long long now = monitor_get_time_us();
+        memcpy(conn->send_buf, &seq, sizeof(seq));
+        memcpy(conn->send_buf + sizeof(seq), &now, sizeof(now));
+        st->sent++;
+        // 发送缓冲区满 (ENOBUFS) 时数据报被丢弃，计入丢包；ECONNREFUSED 表示服务端没有监听 UDP
+        if (send(conn->fd, conn->send_buf, size, 0) < 0 && errno != ENOBUFS && errno != EAGAIN) {
+            LOG_ERROR(g_logger, "send 失败: %s", strerror(errno));
+            return -1;
+        }
+    }
+    return udp_receive(conn, size, pipeline, batch_first, monitor_get_time_us() + timeout_ms * 1000LL, st);
+}
+
+// 填充 Unix 域 socket 地址: 以 @ 开头的名字放在抽象命名空间 (sun_path[0] 为 0，不占用文件系统)
+// 返回地址长度，路径过长返回 0
+static socklen_t unix_sockaddr(const char *path, struct sockaddr_un *addr) {
+    size_t len = strlen(path);
+    if (len == 0 || len >= sizeof(addr->sun_path))
+        return 0;
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path, len);
+    if (path[0] == '@') {
+        addr->sun_path[0] = '\0';
+        return offsetof(struct sockaddr_un, sun_path) + len;
+    }
+    return sizeof(*addr);
+}
+
+// 功能：创建一个到服务器的连接 (UDP 模式下为 connect 过的 UDP socket，unix_path 非 NULL 时为 Unix 域 socket)
 // 返回：成功返回 socket fd，失败返回 -1
-int connect_to_server() {
+int connect_to_server(int udp, const char *unix_path) {
     // 1. 创建 socket
-    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    int fd = socket(unix_path ? AF_UNIX : AF_INET, udp ? SOCK_DGRAM : SOCK_STREAM, 0);
     if (fd < 0) {
         if (g_logger) {
             LOG_ERROR(g_logger, "socket 创建失败: %s", strerror(errno));
@@ -133,22 +393,29 @@ int connect_to_server() {
     }
 
     // 2. 填充服务器地址结构体
-    struct sockaddr_in server_addr;
-    memset(&server_addr, 0, sizeof(server_addr));
-    server_addr.sin_family = AF_INET;
-    server_addr.sin_port = htons(SERVER_PORT);
-
-    // 将 IP 地址从字符串转换为网络字节序
-    if (inet_pton(AF_INET, SERVER_IP, &server_addr.sin_addr) <= 0) {
-        if (g_logger) {
-            LOG_ERROR(g_logger, "inet_pton 失败: %s", strerror(errno));
+    struct sockaddr_storage server_addr;
+    socklen_t addr_len;
+    if (unix_path) {
+        addr_len = unix_sockaddr(unix_path, (struct sockaddr_un *)&server_addr);
+    } else {
+        struct sockaddr_in *in = (struct sockaddr_in *)&server_addr;
+        memset(in, 0, sizeof(*in));
+        in->sin_family = AF_INET;
+        in->sin_port = htons(SERVER_PORT);
+        addr_len = sizeof(*in);
+
+        // 将 IP 地址从字符串转换为网络字节序
+        if (inet_pton(AF_INET, SERVER_IP, &in->sin_addr) <= 0) {
+            if (g_logger) {
+                LOG_ERROR(g_logger, "inet_pton 失败: %s", strerror(errno));
+            }
+            close(fd);
+            return -1;
         }
-        close(fd);
-        return -1;
     }
 
     // 3. 连接到服务器
-    if (connect(fd, (struct sockaddr *)&server_addr, sizeof(server_addr)) < 0) {
+    if (connect(fd, (struct sockaddr *)&server_addr, addr_len) < 0) {
         if (g_logger) {
             LOG_ERROR(g_logger, "connect 失败: %s", strerror(errno));
         }
@@ -156,8 +423,8 @@ int connect_to_server() {
         return -1;
     }
 
-    // 4. 设置 TCP_NODELAY（减少延迟）
-    if (set_nodelay(fd) < 0) {
+    // 4. 设置 TCP_NODELAY（减少延迟）；Unix 域 socket 没有 Nagle 算法
+    if (!udp && !unix_path && set_nodelay(fd) < 0) {
         close(fd);
         return -1;
     }
@@ -165,6 +432,31 @@ int connect_to_server() {
     return fd;
 }
 
+#ifdef ENABLE_TLS
+// 在已连接的 socket 上完成 TLS 握手；kTLS 模式装入密钥后释放 SSL，之后直接 read/write 明文
+// 返回：成功返回 0 并累加握手耗时，失败返回 -1
+static int tls_connect(struct connection *conn, SSL_CTX *ctx, int mode, long long *handshake_us) {
+    long long start = monitor_get_time_us();
+    SSL *ssl = tls_session_handshake(ctx, conn->fd, 0, TLS_HANDSHAKE_TIMEOUT_MS);
+    if (!ssl) {
+        LOG_ERROR(g_logger, "TLS 握手失败");
+        return -1;
+    }
+    *handshake_us += monitor_get_time_us() - start;
+    if (mode == 2) {
+        conn->ssl = ssl;
+        return 0;
+    }
+    int ret = tls_session_install_ktls(ssl, conn->fd, 0);
+    SSL_free(ssl);
+    if (ret < 0) {
+        LOG_ERROR(g_logger, "kTLS 安装失败: %s", strerror(-ret));
+        return -1;
+    }
+    return 0;
+}
+#endif
+
 int main(int argc, char *argv[]) {
     // ========================================
     // 1. 解析命令行参数
@@ -173,18 +465,26 @@ int main(int argc, char *argv[]) {
                            .test_rounds = DEFAULT_ROUNDS,
                            .send_size = DEFAULT_SIZE,
                            .qps_limit = DEFAULT_QPS,
-                           .duration_sec = DEFAULT_DURATION};
+                           .duration_sec = DEFAULT_DURATION,
+                           .pipeline = DEFAULT_PIPELINE,
+                           .udp_timeout_ms = DEFAULT_UDP_TIMEOUT_MS};
 
     static struct option long_options[] = {{"connections", required_argument, 0, 'c'},
                                            {"rounds", required_argument, 0, 'r'},
                                            {"size", required_argument, 0, 's'},
                                            {"qps", required_argument, 0, 'q'},
                                            {"duration", required_argument, 0, 'd'},
+                                           {"pipeline", required_argument, 0, 'p'},
+                                           {"udp", no_argument, 0, 'u'},
+                                           {"udp-timeout", required_argument, 0, 'U'},
+                                           {"unix", required_argument, 0, 'X'},
+                                           {"tls", required_argument, 0, 'T'},
+                                           {"framed", no_argument, 0, 'f'},
                                            {"help", no_argument, 0, 'h'},
                                            {0, 0, 0, 0}};
 
     int opt;
-    while ((opt = getopt_long(argc, argv, "c:r:s:q:d:h", long_options, NULL)) != -1) {
+    while ((opt = getopt_long(argc, argv, "c:r:s:q:d:p:uh", long_options, NULL)) != -1) {
         switch (opt) {
         case 'c':
             config.num_connections = atoi(optarg);
@@ -202,8 +502,8 @@ int main(int argc, char *argv[]) {
             break;
         case 's':
             config.send_size = atoi(optarg);
-            if (config.send_size <= 0 || config.send_size > 65536) {
-                fprintf(stderr, "错误: 数据大小必须在 1-65536 字节之间\n");
+            if (config.send_size <= 0 || config.send_size > MAX_SIZE) {
+                fprintf(stderr, "错误: 数据大小必须在 1-%d 字节之间\n", MAX_SIZE);
                 return 1;
             }
             break;
@@ -221,6 +521,45 @@ int main(int argc, char *argv[]) {
                 return 1;
             }
             break;
+        case 'p':
+            config.pipeline = atoi(optarg);
+            if (config.pipeline <= 0 || config.pipeline > MAX_PIPELINE) {
+                fprintf(stderr, "错误: 流水线深度必须在 1-%d 之间\n", MAX_PIPELINE);
+                return 1;
+            }
+            break;
+        case 'u':
+            config.udp = 1;
+            break;
+        case 'U':
+            config.udp_timeout_ms = atoi(optarg);
+            if (config.udp_timeout_ms <= 0) {
+                fprintf(stderr, "错误: UDP 等待时长必须 > 0\n");
+                return 1;
+            }
+            break;
+        case 'X': {
+            struct sockaddr_un addr;
+            if (unix_sockaddr(optarg, &addr) == 0) {
+                fprintf(stderr, "错误: Unix 域 socket 路径长度必须在 1-%zu 之间\n", sizeof(addr.sun_path) - 1);
+                return 1;
+            }
+            config.unix_path = optarg;
+            break;
+        }
+        case 'f':
+            config.framed = 1;
+            break;
+        case 'T':
+            if (strcmp(optarg, "ktls") == 0) {
+                config.tls = 1;
+            } else if (strcmp(optarg, "user") == 0) {
+                config.tls = 2;
+            } else {
+                fprintf(stderr, "错误: 未知的 TLS 模式 '%s' (ktls 或 user)\n", optarg);
+                return 1;
+            }
+            break;
         case 'h':
             print_usage(argv[0]);
             return 0;
@@ -230,6 +569,30 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (config.udp && config.unix_path) {
+        fprintf(stderr, "错误: --udp 与 --unix 不能同时使用\n");
+        return 1;
+    }
+    if (config.framed && config.udp) {
+        fprintf(stderr, "错误: --framed 只支持流式连接 (TCP / Unix 域 socket)\n");
+        return 1;
+    }
+    if (config.tls && (config.udp || config.unix_path)) {
+        fprintf(stderr, "错误: --tls 只支持 TCP 连接\n");
+        return 1;
+    }
+    if (config.udp && (config.send_size < UDP_HEADER_SIZE || config.send_size > MAX_UDP_SIZE)) {
+        fprintf(stderr, "错误: UDP 模式数据大小必须在 %d-%d 字节之间\n", UDP_HEADER_SIZE, MAX_UDP_SIZE);
+        return 1;
+    }
+    // UDP 不会因两端缓冲区写满而互相阻塞，放不下的数据报直接计入丢包
+    // framed 模式即使 -p 1 也在发送缓冲区中放帧头，按整帧计算
+    int msg_size = config.send_size + (config.framed ? (int)FRAME_HEADER_SIZE : 0);
+    if (!config.udp && config.pipeline > 1 && (long long)config.pipeline * msg_size > MAX_PIPELINE_BYTES) {
+        fprintf(stderr, "错误: 流水线深度 x 数据大小不能超过 %d 字节\n", MAX_PIPELINE_BYTES);
+        return 1;
+    }
+
     // ========================================
     // 2. 初始化日志系统
     // ========================================
@@ -266,10 +629,43 @@ int main(int argc, char *argv[]) {
     LOG_INFO(g_logger, "========================================");
     LOG_INFO(g_logger, "    TCP Echo 客户端压测工具");
     LOG_INFO(g_logger, "========================================");
-    LOG_INFO(g_logger, "服务器: %s:%d", SERVER_IP, SERVER_PORT);
+    if (config.unix_path)
+        LOG_INFO(g_logger, "服务器: %s (Unix 域 socket)", config.unix_path);
+    else
+        LOG_INFO(g_logger, "服务器: %s:%d (%s)", SERVER_IP, SERVER_PORT, config.udp ? "UDP" : "TCP");
     LOG_INFO(g_logger, "并发连接数: %d", config.num_connections);
     LOG_INFO(g_logger, "每连接请求数: %d", config.test_rounds);
     LOG_INFO(g_logger, "发送数据大小: %d 字节", config.send_size);
+    if (config.pipeline > 1) {
+        LOG_INFO(g_logger, "流水线深度: %d 条消息", config.pipeline);
+    }
+    if (config.framed)
+        LOG_INFO(g_logger, "帧协议: 帧头 %u 字节，每帧 %d 字节 (服务端需 -e framed 且 -S >= %d)", FRAME_HEADER_SIZE,
+                 msg_size, msg_size);
+#ifdef ENABLE_TLS
+    SSL_CTX *tls_ctx = NULL;
+    long long tls_handshake_us = 0;
+    if (config.tls) {
+        // 客户端一侧的加解密不是被测对象，内核没有 tls ULP 时退回用户态，服务端仍按自己的模式处理
+        if (config.tls == 1 && !tls_session_ktls_available()) {
+            LOG_WARN(g_logger, "内核没有 tls ULP，客户端改用用户态 TLS");
+            config.tls = 2;
+        }
+        tls_ctx = tls_session_client_ctx(config.tls == 1);
+        if (!tls_ctx) {
+            LOG_ERROR(g_logger, "创建 TLS 上下文失败");
+            monitor_destroy(monitor);
+            logger_close(g_logger);
+            return 1;
+        }
+        LOG_INFO(g_logger, "TLS 1.3: %s", TLS_MODE_NAMES[config.tls]);
+    }
+#else
+    if (config.tls) {
+        LOG_WARN(g_logger, "--tls 需要 TLS 版本 (make all-tls)，以明文连接");
+        config.tls = 0;
+    }
+#endif
     LOG_INFO(g_logger, "日志文件: %s", log_filename);
 
     // ========================================
@@ -286,8 +682,9 @@ int main(int argc, char *argv[]) {
     LOG_INFO(g_logger, "正在建立连接...");
 
     for (int i = 0; i < config.num_connections; i++) {
-        conns[i].send_buf = malloc(config.send_size);
-        conns[i].recv_buf = malloc(config.send_size);
+        // framed 模式一批帧在发送缓冲区中连续排列，整批一次写出
+        conns[i].send_buf = malloc((size_t)msg_size * (config.framed ? config.pipeline : 1));
+        conns[i].recv_buf = malloc((size_t)msg_size * config.pipeline);
 
         if (!conns[i].send_buf || !conns[i].recv_buf) {
             LOG_ERROR(g_logger, "缓冲区内存分配失败");
@@ -304,12 +701,21 @@ int main(int argc, char *argv[]) {
             return 1;
         }
 
-        conns[i].fd = connect_to_server();
+        conns[i].fd = connect_to_server(config.udp, config.unix_path);
+        conns[i].next_seq = 0;
+        conns[i].max_seen = 0;
+#ifdef ENABLE_TLS
+        conns[i].ssl = NULL;
+        if (conns[i].fd >= 0 && config.tls && tls_connect(&conns[i], tls_ctx, config.tls, &tls_handshake_us) < 0) {
+            close(conns[i].fd);
+            conns[i].fd = -1;
+        }
+#endif
         if (conns[i].fd < 0) {
             LOG_ERROR(g_logger, "连接 %d 创建失败", i);
             // 关闭已创建的连接
             for (int j = 0; j < i; j++) {
-                close(conns[j].fd);
+                conn_close(&conns[j]);
                 free(conns[j].send_buf);
                 free(conns[j].recv_buf);
             }
@@ -321,11 +727,15 @@ int main(int argc, char *argv[]) {
             return 1;
         }
         // 初始化 send_buf（填充测试数据，每个连接不同）
-        memset(conns[i].send_buf, 'A' + (i % 26), config.send_size);
+        memset(conns[i].send_buf, 'A' + (i % 26), (size_t)msg_size * (config.framed ? config.pipeline : 1));
         LOG_DEBUG(g_logger, "连接 %d 建立成功 (fd=%d)", i, conns[i].fd);
     }
 
     LOG_INFO(g_logger, "所有连接建立成功");
+#ifdef ENABLE_TLS
+    if (config.tls)
+        LOG_INFO(g_logger, "TLS 握手: 平均 %.1f us", (double)tls_handshake_us / config.num_connections);
+#endif
 
     // ========================================
     // 6. 开始性能测试
@@ -343,6 +753,7 @@ int main(int argc, char *argv[]) {
     long long start_time = monitor_get_time_us();
     long long success_count = 0;
     long long fail_count = 0;
+    UdpStats udp_stats = {0};
 
     // 计算结束时间
     long long end_time_target = (config.duration_sec > 0) ? start_time + (config.duration_sec * 1000000LL) : LLONG_MAX;
@@ -350,8 +761,8 @@ int main(int argc, char *argv[]) {
     // QPS 限制相关
     long long sleep_interval_us = 0;
     if (config.qps_limit > 0) {
-        // 每个连接的发送间隔 = 1秒 / (QPS限制 / 连接数)
-        sleep_interval_us = (1000000LL * config.num_connections) / config.qps_limit;
+        // 每个连接的发送间隔 = 1秒 / (QPS限制 / 连接数)，每次发送一批 pipeline 条消息
+        sleep_interval_us = (1000000LL * config.num_connections * config.pipeline) / config.qps_limit;
         LOG_INFO(g_logger, "发送间隔: %lld 微秒", sleep_interval_us);
     }
 
@@ -375,12 +786,21 @@ int main(int argc, char *argv[]) {
 
         // 执行测试
         for (int i = 0; i < config.num_connections; i++) {
-            if (do_echo_test(conns[i].fd, conns[i].send_buf, conns[i].recv_buf, config.send_size) < 0) {
+            long long batch_start = monitor_get_time_us();
+            int received = 0;
+            if (config.udp)
+                received = do_udp_echo_test(&conns[i], config.send_size, config.pipeline, config.udp_timeout_ms,
+                                            &udp_stats);
+            else if (config.framed)
+                received = do_framed_echo_test(&conns[i], config.send_size, config.pipeline);
+            else if (do_echo_test(&conns[i], config.send_size, config.pipeline) < 0)
+                received = -1;
+            if (received < 0) {
                 LOG_ERROR(g_logger, "Echo 测试失败 (连接 %d, 轮次 %d)", i, round);
                 fail_count++;
                 // 关闭所有连接并退出
                 for (int j = 0; j < config.num_connections; j++) {
-                    close(conns[j].fd);
+                    conn_close(&conns[j]);
                     free(conns[j].send_buf);
                     free(conns[j].recv_buf);
                 }
@@ -389,7 +809,15 @@ int main(int argc, char *argv[]) {
                 logger_close(g_logger);
                 return 1;
             }
-            success_count++;
+            // UDP 模式按每个数据报记录延迟 (在 udp_receive 中)，framed 模式按每帧记录
+            if (config.udp) {
+                success_count += received;
+            } else if (config.framed) {
+                success_count += config.pipeline;
+            } else {
+                latency_record(monitor_get_time_us() - batch_start);
+                success_count += config.pipeline;
+            }
         }
 
         round++;
@@ -426,13 +854,25 @@ int main(int argc, char *argv[]) {
     long long end_time = monitor_get_time_us();
     double elapsed_sec = (end_time - start_time) / 1000000.0;
 
+    // UDP 模式: 最后再等一个超时时长收下迟到的回显，之后仍未到的才算丢包 (不计入耗时)
+    if (config.udp && udp_stats.received < udp_stats.sent) {
+        long long deadline = monitor_get_time_us() + config.udp_timeout_ms * 1000LL;
+        for (int i = 0; i < config.num_connections && udp_stats.received < udp_stats.sent; i++) {
+            udp_receive(&conns[i], config.send_size, INT_MAX, conns[i].next_seq, deadline, &udp_stats);
+        }
+    }
+    long long udp_lost = udp_stats.sent - udp_stats.received;
+    double udp_loss_pct = udp_stats.sent ? 100.0 * udp_lost / udp_stats.sent : 0.0;
+
     // ========================================
     // 7. 计算性能指标
     // ========================================
-    long long total_requests = config.test_rounds * config.num_connections;
+    long long total_requests = (long long)config.test_rounds * config.num_connections * config.pipeline;
     double qps = success_count / elapsed_sec;
     double avg_latency_us = (elapsed_sec * 1000000) / success_count;
     double throughput_mbps = (success_count * config.send_size * 8) / (elapsed_sec * 1000000);
+    long long p50 = latency_percentile(0.50), p90 = latency_percentile(0.90);
+    long long p99 = latency_percentile(0.99), p999 = latency_percentile(0.999);
 
     // ========================================
     // 7. 采集最终系统状态
@@ -456,6 +896,13 @@ int main(int argc, char *argv[]) {
     LOG_INFO(g_logger, "总耗时:           %.2f 秒", elapsed_sec);
     LOG_INFO(g_logger, "QPS:              %.2f 请求/秒", qps);
     LOG_INFO(g_logger, "平均延迟:         %.2f 微秒", avg_latency_us);
+    LOG_INFO(g_logger, "往返延迟 (%s):  p50 %lld / p90 %lld / p99 %lld / p99.9 %lld / max %lld 微秒",
+             config.udp ? "每包" : config.framed ? "每帧" : "每批", p50, p90, p99, p999, g_latency_max);
+    if (config.udp) {
+        LOG_INFO(g_logger, "UDP 数据报:       发送 %lld / 收到 %lld / 丢失 %lld (%.3f%%)", udp_stats.sent,
+                 udp_stats.received, udp_lost, udp_loss_pct);
+        LOG_INFO(g_logger, "UDP 乱序:         %lld (其中超时后到达 %lld)", udp_stats.reordered, udp_stats.late);
+    }
     LOG_INFO(g_logger, "吞吐量:           %.2f Mbps", throughput_mbps);
 
     // ========================================
@@ -487,12 +934,22 @@ int main(int argc, char *argv[]) {
     printf("  \"test_config\": {\n");
     printf("    \"connections\": %d,\n", config.num_connections);
     printf("    \"rounds\": %d,\n", config.test_rounds);
-    printf("    \"send_size\": %d\n", config.send_size);
+    printf("    \"send_size\": %d,\n", config.send_size);
+    printf("    \"pipeline\": %d,\n", config.pipeline);
+    printf("    \"transport\": \"%s\",\n", config.udp ? "udp" : config.unix_path ? "unix" : "tcp");
+    printf("    \"tls\": \"%s\",\n", TLS_MODE_NAMES[config.tls]);
+    printf("    \"protocol\": \"%s\"\n", config.framed ? "framed" : "raw");
     printf("  },\n");
     printf("  \"performance\": {\n");
     printf("    \"qps\": %.2f,\n", qps);
     printf("    \"latency_us\": %.2f,\n", avg_latency_us);
+    printf("    \"rtt_us\": {\"p50\": %lld, \"p90\": %lld, \"p99\": %lld, \"p999\": %lld, \"max\": %lld},\n", p50, p90,
+           p99, p999, g_latency_max);
     printf("    \"throughput_mbps\": %.2f,\n", throughput_mbps);
+    if (config.udp)
+        printf("    \"udp\": {\"sent\": %lld, \"received\": %lld, \"lost\": %lld, \"loss_pct\": %.3f, "
+               "\"reordered\": %lld, \"late\": %lld},\n",
+               udp_stats.sent, udp_stats.received, udp_lost, udp_loss_pct, udp_stats.reordered, udp_stats.late);
     printf("    \"elapsed_sec\": %.2f\n", elapsed_sec);
     printf("  },\n");
     printf("  \"system\": {\n");
@@ -514,11 +971,14 @@ int main(int argc, char *argv[]) {
     LOG_INFO(g_logger, "");
     LOG_INFO(g_logger, "关闭连接...");
     for (int i = 0; i < config.num_connections; i++) {
-        close(conns[i].fd);
+        conn_close(&conns[i]);
         free(conns[i].send_buf);
         free(conns[i].recv_buf);
     }
     free(conns);
+#ifdef ENABLE_TLS
+    SSL_CTX_free(tls_ctx);
+#endif
 
     LOG_INFO(g_logger, "测试完成！");
 
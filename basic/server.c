@@ -2,6 +2,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stddef.h>
 #include <unistd.h>
 #include <errno.h>
 #include <fcntl.h>
@@ -9,48 +10,452 @@
 #include <sys/socket.h>
 #include <sys/un.h>
 #include <sys/stat.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
 #include <netinet/in.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <arpa/inet.h>
 #include <signal.h>
 #include <pthread.h>
 #include <time.h>
 #include <sched.h>
+#include <getopt.h>
+#include <limits.h>
 #include <liburing.h>
 
 // 引入日志和监控模块
 #include "logger.h"
 #include "monitor.h"
+#include "slab_pool.h"
+#include "topology.h"
+#include "timer_wheel.h"
+#include "frame.h"
+#include "histogram.h"
+#include "seqlock.h"
 
 #ifdef ENABLE_EBPF
 #include "sockmap_loader.h"
+#include "reuseport_loader.h"
+#endif
+
+#ifdef ENABLE_TLS
+#include "tls_session.h"
+#include <openssl/err.h>
+#endif
+
+// io_uring_register_napi 从 liburing 2.6 开始提供；更老的 liburing 只能用 socket 级的 SO_BUSY_POLL
+#if defined(IO_URING_CHECK_VERSION) && !IO_URING_CHECK_VERSION(2, 6)
+#define HAVE_URING_NAPI 1
+#endif
+
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+#ifndef SO_BUSY_POLL_BUDGET
+#define SO_BUSY_POLL_BUDGET 70
 #endif
 
 #define PORT 8888
 #define QUEUE_DEPTH 4096  // io_uring 队列深度
-#define BUFFER_SIZE 4096
+#define CQ_DEPTH (QUEUE_DEPTH * 4)  // CQ 深度: 每连接都可能有一个在途操作，突发完成时不易溢出
+#define DEFERRED_SQE_INIT 256       // 延迟提交队列的初始容量，不够时翻倍
+#define BUFFER_SIZE 4096                // 默认单次读缓冲区大小
+#define MAX_BUFFER_SIZE (1024 * 1024)
 #define BACKLOG 4096
 #define CONTROL_SOCKET "/tmp/tcp_echo_server.sock"
+#define HISTORY_SECONDS 600       // 控制线程每秒采样一次，history 命令最多回看 10 分钟
+#define HISTORY_DEFAULT 60        // history 命令不带参数时返回的秒数
+
+#define DEFAULT_BUF_RING_ENTRIES 4096  // 每个 Worker 的 provided buffer 数量
+#define MAX_BUF_RING_ENTRIES 32768     // 内核限制: buffer ring 最多 32768 项
+#define BUF_GROUP_ID 0
+
+#define ZC_SIZE_CLASSES 12                 // 零拷贝统计按 2 的幂分档: 512B, 1K, ... 1M
+#define ZC_MIN_SHIFT 9
+#define ZC_PROBE_WINDOW_US 100000          // 采样窗口长度，auto 模式每个窗口切换一次发送路径
+#define ZC_MIN_SAMPLE_BYTES (1024 * 1024)  // 计算交叉点时每档每条路径至少需要的样本字节数
+
+#define DEFAULT_SQPOLL_IDLE_MS 1000  // SQPOLL 内核线程空闲多久后休眠
+#define DEFAULT_BATCH_WAIT_US 100    // DEFER_TASKRUN 模式凑批等待上限
+#define MAX_BUSY_POLL_US 100000      // busy poll 与自旋时长上限
+#define DEFAULT_MIGRATE_THRESHOLD 25   // 负载偏离平均值超过该百分比才触发迁移
+#define DEFAULT_MIGRATE_INTERVAL_MS 100  // 负载统计窗口
+#define TIMER_TICK_US 10000          // 连接超时时间轮的精度
+#define TIMER_WHEEL_SLOTS 4096       // 时间轮槽位数，一圈约 41 秒，更长的超时在槽位中等待多圈
+#define STATS_PUBLISH_US 1000        // Worker 发布 stats 快照的最小间隔
+#define UDP_BATCH 64                 // 每次 recvmmsg / sendmmsg 最多处理的消息数
+#define UDP_GRO_BUF_SIZE 65536       // 开启 GRO 时每个接收槽位的大小 (合并后的最大长度)
+#define UDP_GSO_MAX_BYTES 65000      // 单条 GSO 消息的载荷上限 (IP 包长 64KB 减去头部)
+#define UDP_GSO_MAX_SEGS 64          // 单条 GSO 消息的最大段数 (旧内核的 UDP_MAX_SEGMENTS)
+
+#define DEFAULT_LINK_DEPTH 4  // linked 模式每条链包含的 read→send 对数
+#define MAX_LINK_DEPTH 64
+
+#define DEFAULT_PIPE_POOL 64  // splice 模式每个 Worker 预先创建的 pipe 数
+#define PIPE_DEFAULT_SIZE 65536
+
+#define DEFAULT_PIPELINE_DEPTH 4  // pipelined 模式每连接的读缓冲槽位数
+#define MAX_PIPELINE_DEPTH 64
+
+#define DEFAULT_MAX_MSG (1024 * 1024)  // stream 模式每连接最多缓冲的未回显字节数
+#define MAX_MAX_MSG (64 * 1024 * 1024)
+#define STREAM_MAX_IOV 64              // stream 模式单次 writev 最多覆盖的块数
+
+#define COALESCE_RATE_SHIFT 4                        // --coalesce: 每次写合并消息数的 EWMA 定点小数位
+#define COALESCE_BATCHED_ON (2 << COALESCE_RATE_SHIFT)    // 平均每次写合并 >= 2 条消息视为对端在流水线发送
+#define COALESCE_BATCHED_OFF (3 << (COALESCE_RATE_SHIFT - 1))  // 回落到 1.5 条以下恢复为交互式
+
+#define DEFAULT_SLAB_OBJECTS 1024  // 每个 Worker 连接对象池的预分配对象数
+
+#define EPOLL_MAX_EVENTS 1024  // epoll 后端每次 epoll_wait 最多取回的事件数
 
 // ==========================================
 // io_uring 上下文定义
 // ==========================================
 
-typedef enum { EVENT_ACCEPT, EVENT_READ, EVENT_WRITE } EventType;
+typedef enum {
+    EVENT_ACCEPT,
+    EVENT_READ,
+    EVENT_WRITE,
+    EVENT_RECV,
+    EVENT_SEND,
+    EVENT_CLOSE,
+    EVENT_LINK,
+    EVENT_SPLICE,
+    EVENT_PIPELINE,
+    EVENT_STREAM,
+    EVENT_SPARSE,
+    EVENT_FRAMED,
+    EVENT_MIGRATE,  // 本 Worker 经 MSG_RING 移交连接的结果
+    EVENT_ADOPT,    // 其他 Worker 移交过来的连接
+    EVENT_UDP,      // UDP socket 可读 (multishot poll)
+    EVENT_TLS       // 握手中的连接等待 socket 就绪 (server_tls 版本)
+} EventType;
 
-// 每个 I/O 操作的上下文
+// 所有作为 user_data 提交的上下文都以 IoHeader 开头，CQE 分发时只看 type
 typedef struct {
     int fd;
     EventType type;
-    char buffer[BUFFER_SIZE];
+} IoHeader;
+
+// 每个 I/O 操作的上下文
+typedef struct {
+    IoHeader hdr;
+    int zc_res;  // 零拷贝发送的首个 CQE 结果，等待通知 CQE 期间暂存
+    TimerNode timer;  // 空闲 / 写阻塞超时
+    long long read_ns;  // --latency: 请求的 READ CQE 被收割的时间
     struct iovec iov;
     struct msghdr msg;  // 用于 sendmsg/recvmsg (可选，这里用 readv/writev 简化)
+#ifdef ENABLE_TLS
+    SSL *ssl;           // --tls user: 密文经 buffer 收发，由 SSL 在用户态加解密；kTLS 连接为 NULL
+#endif
+    char buffer[];      // g_config.buf_size 字节
 } IoContext;
 
+#ifdef ENABLE_TLS
+// 握手中的连接: io_uring 后端单独分配，每次等待挂一个 POLL_ADD (user_data 指向它)；
+// epoll 后端嵌在 EpollConn 中，等待的是连接注册时的边缘触发事件
+typedef struct {
+    IoHeader hdr;        // EVENT_TLS
+    SSL *ssl;            // 握手完成或失败后为 NULL
+    TimerNode timer;     // 握手超时，挂在 Worker 的 tls_timers 上
+    long long start_ns;  // accept 的时间
+} TlsHandshake;
+#endif
+
+// multishot 模式的轻量上下文：
+//   EVENT_RECV - RecvConn，每连接一个，不带缓冲区，数据落在 Worker 共享的 buffer ring 中
+//   EVENT_SEND - BufContext，每个 provided buffer 一个 (按 bid 索引)，发送完成后归还 buffer
+// 同一 socket 上互不关联的多个 send 在 io_uring 中不保证按提交顺序写入 (等待可写或部分写出后重试时会被后提交的
+// 超过)，所以每连接同一时刻只有一个 send 在途，之后收到的 buffer 按到达顺序挂在连接的发送队列上，
+// 前一个写完再从完成处理中发出下一个
+struct RecvConn;
+
+typedef struct BufContext {
+    IoHeader hdr;
+    unsigned short bid;
+    int zc_res;
+    long long start_ns;        // --latency: 对应的 recv CQE 被收割的时间
+    struct BufContext *next;   // 同一连接发送队列中的下一个 buffer
+    struct RecvConn *conn;     // 所属连接
+    unsigned len;              // buffer 中的数据长度
+    unsigned off;              // 已写出的字节数 (短写后从这里继续)
+} BufContext;
+
+typedef struct RecvConn {
+    IoHeader hdr;
+    BufContext *head;           // 发送队列: head 为在途的 send，tail 为最后收到的 buffer
+    BufContext *tail;
+    struct RecvConn *starved_next;  // Worker 的饥饿连接链表
+    int closing;  // multishot recv 已因 EOF/错误终止 (或发送失败)，发送队列清空后释放
+    int failed;   // 发送失败: 丢弃之后收到的数据
+    int starved;  // multishot recv 因 buffer 耗尽 (-ENOBUFS) 终止，挂在饥饿链表上等待 buffer 归还
+} RecvConn;
+
+// SQ 满时暂存的 SQE，下一轮事件循环按 FIFO 搬进 SQ
+// chain: 链首记录整条链的 SQE 数 (单个 SQE 为 1)，链内其余项为 0；整条链只在 SQ 能一次容纳时才搬运
+typedef struct {
+    struct io_uring_sqe sqe;
+    unsigned chain;
+} DeferredSqe;
+
+// linked 模式: read 与 send 以 IOSQE_IO_LINK 串成一条链，除链尾外都带 IOSQE_CQE_SKIP_SUCCESS，
+// 正常情况下每条链只产生一个 CQE。链上每个 SQE 的 user_data 是 ops[] 中的一项，按下标区分:
+//   ops[0]      - 链首补发的 send (上一条链断开时已读到、尚未回显的数据)
+//   ops[1 + 2j] - 第 j 对的 read，长度为 msg_len；短读视为失败，链上后续 SQE 被取消
+//   ops[2 + 2j] - 第 j 对的 send
+struct LinkConn;
+
+typedef struct {
+    IoHeader hdr;
+    unsigned idx;
+    void *conn;  // LinkConn / SpliceConn / PipelineConn / StreamConn / FramedConn，由 hdr.type 区分
+} LinkOp;
+
+// --coalesce 的每连接状态 (pipelined / framed 模式)。本批 CQE 中有回显待写的连接挂在 Worker 的 flush 链表上，
+// 整批处理完才提交一次写，同一批里先后完成的多个读合并为一次写出
+typedef struct CoalesceNode {
+    struct CoalesceNode *next;
+    LinkOp *op;        // 连接的 write op，hdr.type 区分所属模式
+    int queued;        // 已挂在 flush 链表上
+    int rate;          // 每次写合并的消息数的 EWMA (定点，COALESCE_RATE_SHIFT 位小数)
+    int batched;       // 对端在流水线发送: 关闭 quickack，ACK 捎带在合并后的回显上
+} CoalesceNode;
+
+typedef struct LinkConn {
+    int fd;
+    unsigned msg_len;      // 学习到的消息长度，链上的 read/send 都使用该长度
+    unsigned lead_len;     // 当前链首补发 send 的长度，0 表示没有
+    int learning;          // 当前链以一次 buf_size 长度的 read 结尾，用其结果重新学习 msg_len
+    unsigned chain_start;  // 当前链的第一个 ops 下标，CQE 之前的 SQE 都已成功
+    char *buffer;  // g_config.buf_size 字节，位于 ops[] 之后
+    LinkOp ops[];  // 1 + 2 * link_depth 项
+} LinkConn;
+
+// splice 模式: 数据经由每连接一个 pipe 在内核内转发，不进入用户态。稳态下每个请求一条链:
+//   send(pipe→socket, 上次读到的长度) → POLL_ADD(POLLIN) → splice(socket→pipe, buf_size)
+// 只有链尾的 splice 产生 CQE；POLL_ADD 让空闲连接不占用 io-wq 线程 (splice 总是在 io-wq 中执行)
+enum { SPLICE_OP_OUT, SPLICE_OP_POLL, SPLICE_OP_IN, SPLICE_OPS };
+
+typedef struct {
+    int fd;
+    int pipe_fds[2];
+    unsigned pending;      // 已读入 pipe、尚未写回 socket 的字节数，由下一条链的链首 splice 写出
+    unsigned chain_start;  // 当前链的第一个 ops 下标
+    LinkOp ops[SPLICE_OPS];
+} SpliceConn;
+
+// pipelined 模式: 读写解耦。每连接 pipeline_depth 个 buf_size 的槽位组成环形队列，read 总是落在下一个
+// 空槽位，不必等之前的回显写完；已读入的槽位按 FIFO 排队，同一时刻最多一个 writev 在途，
+// 它把排队的全部槽位合并为一次多 iovec 的写，短写时从断点继续
+enum { PIPELINE_OP_READ, PIPELINE_OP_WRITE, PIPELINE_OPS };
+
+typedef struct {
+    int fd;
+    unsigned head;      // 最早一个尚未写完的槽位
+    unsigned filled;    // 已读入、尚未全部写出的槽位数
+    unsigned head_off;  // head 槽位中已写出的字节数
+    int reading;        // read 在途
+    int writing;        // writev 在途
+    int closing;        // 1: 对端 EOF，写完排队数据后关闭; 2: 出错，丢弃排队数据
+    CoalesceNode co;
+    LinkOp ops[PIPELINE_OPS];
+    char *buffer;         // pipeline_depth * buf_size 字节，位于 iov[] 之后
+    struct iovec iov[];   // 前 depth 项为槽位 (iov_len 为已读入的长度)，后 depth 项为 writev 的向量
+} PipelineConn;
+
+// stream 模式: 面向大消息的流式回显。读入的数据追加到每连接的块链表 (每块 buf_size 字节，来自 Worker 的块池)，
+// 输出队列即块链表本身: writev 一次覆盖从 head 开始的多个块，短写时从断点重新提交剩余字节。
+// 队列中未回显的数据达到 max_msg 时暂停读取，由 TCP 流控把压力传回客户端
+typedef struct StreamChunk {
+    struct StreamChunk *next;
+    unsigned len;  // 已读入的字节数，满块为 buf_size
+    char data[];   // g_config.buf_size 字节
+} StreamChunk;
+
+typedef struct {
+    int fd;
+    StreamChunk *head;   // 最早一个尚未写完的块
+    StreamChunk *tail;   // 最新的块，未满时下一次 read 继续写入
+    unsigned head_off;   // head 块中已写出的字节数
+    unsigned queued;     // 已读入、尚未写出的字节数
+    unsigned write_len;  // 在途 writev 的总长度，用于识别短写
+    int reading;
+    int writing;
+    int closing;  // 取值同 PipelineConn
+    LinkOp ops[PIPELINE_OPS];  // 与 pipelined 模式相同: [0] read, [1] writev
+    struct iovec vec[STREAM_MAX_IOV];
+} StreamConn;
+
+// framed 模式: 长度前缀帧协议 (common/include/frame.h)，每连接一块 buf_size 的线性缓冲区:
+//   [out_off, parsed) 已解析出的完整帧，等待回显 | [parsed, filled) 未收齐的帧 | [filled, buf_size) 空闲
+// read 完成后从 parsed 开始只读帧头逐帧切分，完整的帧在原处回显，不拷贝载荷；没有 write 在途时排队的全部完整帧
+// 合并为一次 write。尾部空间放不下未收齐的帧时，在读写都不在途的时刻把它搬到缓冲区开头
+typedef struct {
+    int fd;
+    unsigned out_off;    // 下一个待写出的字节
+    unsigned parsed;     // 完整帧的结束位置，也是下一帧帧头的位置
+    unsigned filled;     // 已读入的结束位置
+    unsigned next_size;  // 未收齐的帧的总长度 (帧头未收齐时为帧头长度)，0 表示没有
+    unsigned write_len;  // 在途 write 的长度，用于识别短写
+    unsigned frames;     // 已解析、尚未提交写的完整帧数
+    int reading;
+    int writing;
+    int closing;  // 取值同 PipelineConn
+    CoalesceNode co;
+    LinkOp ops[PIPELINE_OPS];  // 与 pipelined 模式相同: [0] read, [1] write
+    char buffer[];             // g_config.buf_size 字节
+} FramedConn;
+
+// sparse 模式: 空闲连接只挂一个 POLL_ADD(POLLIN)，不持有任何数据缓冲区；POLLIN 到达后才从 Worker 的共享
+// buffer 池取一块，完成 recv → send 后继续非阻塞 recv，直到 -EAGAIN 再把 buffer 还回池中并重新挂 poll。
+// 每个连接同一时刻只有一个请求在途，state 表示它是哪一种
+typedef enum { SPARSE_POLL, SPARSE_RECV, SPARSE_SEND } SparseState;
+
+typedef struct {
+    IoHeader hdr;
+    SparseState state;
+    TimerNode timer;
+    unsigned off;  // send 阶段: buf 中已写出的字节数与总长度
+    unsigned len;
+    char *buf;  // 仅 recv/send 期间持有
+} SparseConn;
+
+// epoll 后端的每连接上下文：读到的数据没能一次写完时，剩余部分在 EPOLLOUT 到来后继续发送
+typedef struct {
+    int fd;
+    TimerNode timer;
+    unsigned out_off;  // buffer 中待发送数据的位置与长度
+    unsigned out_len;
+#ifdef ENABLE_TLS
+    TlsHandshake hs;  // hs.ssl 非 NULL 时握手尚未完成，就绪事件用来推进握手
+#endif
+    char buffer[];  // g_config.buf_size 字节
+} EpollConn;
+
+// UDP 回显: 每个 Worker 一个 SO_REUSEPORT UDP socket，可读时 recvmmsg 一次收一批，按来源地址 sendmmsg 一次发回。
+// 开启 GSO 时同一对端、同样段长的连续消息合并为一条带 UDP_SEGMENT 的消息；开启 GRO 时内核把同一流的数据报
+// 合并交付 (cmsg 给出段长)，按原段长 GSO 发回，对端收到的仍是原来的数据报
+typedef struct {
+    int fd;
+    size_t slot_size;  // 每个接收槽位的大小: buf_size，开启 GRO 时为 UDP_GRO_BUF_SIZE
+    char *buffers;     // UDP_BATCH 个接收槽位
+    struct mmsghdr rx[UDP_BATCH];
+    struct iovec rx_iov[UDP_BATCH];
+    struct sockaddr_storage addrs[UDP_BATCH];
+    char rx_ctrl[UDP_BATCH][CMSG_SPACE(sizeof(int))] __attribute__((aligned(8)));
+    struct mmsghdr tx[UDP_BATCH];
+    struct iovec tx_iov[UDP_BATCH];
+    unsigned tx_segs[UDP_BATCH];  // 每条发送消息包含的数据报数
+    char tx_ctrl[UDP_BATCH][CMSG_SPACE(sizeof(uint16_t))] __attribute__((aligned(8)));
+} UdpState;
+
 // ==========================================
 // 配置与统计结构
 // ==========================================
 
+// Worker 事件循环后端
+typedef enum {
+    BACKEND_IO_URING,  // io_uring (回显模式见 EchoMode)
+    BACKEND_EPOLL,     // epoll 边缘触发 + 非阻塞 recv/send，用于 io_uring 被禁用的主机和对比测试
+} BackendType;
+
+static const char *BACKEND_NAMES[] = {"io_uring", "epoll"};
+
+// 回显数据路径 (io_uring 后端)
+typedef enum {
+    ECHO_CLASSIC,    // 单次 accept + readv/writev，每连接独占 IoContext 缓冲区
+    ECHO_MULTISHOT,  // multishot accept + multishot recv，数据来自 provided buffer ring
+    ECHO_LINKED,     // read→send 以 IOSQE_IO_LINK 成链批量提交，只为整条链的完成或出错处理 CQE
+    ECHO_SPLICE,     // socket→pipe→socket 的 IORING_OP_SPLICE 链，数据不经过用户态
+    ECHO_PIPELINED,  // 每连接多个读缓冲槽位，read 与 writev 并行在途，排队的回显合并写出
+    ECHO_STREAM,     // 大消息流式回显: 读入块链表，输出队列处理短写，每连接最多缓冲 max_msg 字节
+    ECHO_SPARSE,     // 空闲连接只挂 POLL_ADD，有数据时才从共享池取 buffer，面向海量空闲连接
+    ECHO_FRAMED,     // 长度前缀帧协议: 增量解析出完整帧后原地回显，多个帧合并为一次 write
+} EchoMode;
+
+static const char *ECHO_MODE_NAMES[] = {"classic",   "multishot", "linked", "splice",
+                                           "pipelined", "stream",    "sparse", "framed"};
+
+// TLS 模式 (server_tls 版本): 握手都在用户态完成，区别在于之后记录由谁加解密
+typedef enum {
+    TLS_MODE_OFF,
+    TLS_MODE_KTLS,  // 密钥装入内核 (SOL_TLS)，回显路径不变，socket 上收发的就是明文
+    TLS_MODE_USER,  // io_uring 收发密文，Worker 线程用 OpenSSL 内存 BIO 解密再加密 (仅 classic 模式)
+} TlsMode;
+
+static const char *TLS_MODE_NAMES[] = {"off", "ktls", "user"};
+
+typedef struct {
+    BackendType backend;
+    EchoMode echo_mode;
+    unsigned buf_ring_entries;  // 每个 Worker 的 buffer ring 项数 (2 的幂)
+    unsigned buf_size;          // 单次读缓冲区大小 (classic 的 IoContext 与 buffer ring 共用)
+    unsigned zc_threshold;      // >= 该长度的回显走 IORING_OP_SEND_ZC，0 表示关闭
+    int zc_auto;                // 按窗口交替 copy/zc，测量两条路径的 CPU 开销
+    unsigned fixed_files;       // 每个 ring 的稀疏 fixed file 表大小，0 表示使用普通 fd
+    int sqpoll;                 // IORING_SETUP_SQPOLL: 内核线程轮询 SQ，提交无需系统调用
+    cpu_set_t sqpoll_cpus;      // SQPOLL 线程绑定的 CPU (IORING_SETUP_SQ_AFF)，Worker 不会使用这些 CPU
+    int sqpoll_cpu_count;
+    cpu_set_t client_cpus;      // 保留给 client 的 CPU，Worker 不会使用
+    int client_cpu_count;
+    char numa_nic[32];          // 优先占满该网卡所在的 NUMA 节点
+    unsigned sqpoll_idle_ms;
+    int defer_taskrun;          // SINGLE_ISSUER | DEFER_TASKRUN | COOP_TASKRUN + 注册 ring fd
+    unsigned min_batch;         // DEFER_TASKRUN 模式每次 io_uring_enter 至少等待的 CQE 数
+    unsigned batch_wait_us;     // 凑不齐 min_batch 时的最长等待
+    unsigned link_depth;        // linked 模式每条链的 read→send 对数
+    unsigned pipe_pool;         // splice 模式每个 Worker 缓存的 pipe 数
+    unsigned pipeline_depth;    // pipelined 模式每连接的读缓冲槽位数
+    unsigned max_msg;           // stream 模式每连接最多缓冲的未回显字节数
+    unsigned busy_poll_us;      // NAPI busy poll 时长: 注册到 ring (io_uring_register_napi) 并设置 SO_BUSY_POLL
+    unsigned busy_poll_budget;  // SO_BUSY_POLL_BUDGET: 每次 busy poll 最多处理的包数，0 表示内核默认
+    int prefer_busy_poll;       // SO_PREFER_BUSY_POLL / napi.prefer_busy_poll: busy poll 期间抑制软中断
+    int coalesce;               // 新连接设置 TCP_NODELAY；pipelined / framed 模式按 CQE 批次合并写出，
+                                // 按每连接的消息速率切换 TCP_QUICKACK，已知还有回显跟随时带 MSG_MORE
+    int latency;                // 每个 Worker 记录服务时间与事件循环每轮耗时的直方图 (控制命令 latency)
+    unsigned spin_us;           // 阻塞等待前自旋轮询 CQ 的最长时间 (自适应，0 表示关闭)
+    int migrate;                // classic 模式: 空闲 Worker 从最忙的 Worker 窃取连接，经 IORING_OP_MSG_RING 移交
+    unsigned migrate_threshold; // 负载低于平均值该百分比的 Worker 才会窃取，且被窃取方须高于平均值同样比例
+    unsigned migrate_interval_ms;  // 负载统计窗口，每个窗口每个 Worker 最多迁出一个连接
+    unsigned idle_timeout_ms;   // 连接在该时长内没有收到数据则关闭，0 为不限
+    unsigned write_timeout_ms;  // 回显写出在该时长内没有任何进展 (对端不读) 则关闭，0 为不限
+    int udp;                    // 同端口上提供 UDP 回显
+    int udp_gso;                // UDP 回显合并发送 (UDP_SEGMENT)
+    int udp_gro;                // UDP 接收合并 (UDP_GRO)，隐含 udp_gso
+    const char *unix_path;      // 同时在该 Unix 域 socket 上提供流式回显，以 @ 开头为抽象命名空间
+    TlsMode tls;                // TLS 1.3 回显 (server_tls 版本)
+    const char *tls_cert;       // PEM 证书链，NULL 时生成临时自签名证书
+    const char *tls_key;        // PEM 私钥，NULL 时与证书同一文件
+    int reuseport_lb;           // eBPF 版本: SO_REUSEPORT 组挂载选择程序，新连接分派给负载最低的 Worker
+    int prefer_syn_cpu;         // 分派时优先选择收到 SYN 的 CPU 上的 Worker
+    unsigned syn_cpu_slack;     // 该 Worker 的负载最多可比最空闲的 Worker 高出多少
+    int rcvbuf;                 // 监听 socket 的 SO_RCVBUF，新连接继承；0 表示使用内核默认 (自动调节)
+    int sndbuf;                 // 监听 socket 的 SO_SNDBUF
+    unsigned slab_objects;      // 每个 Worker 连接对象池的容量，0 表示直接使用 malloc
+    int slab_hugepages;         // 对象池使用 2MB 大页
+} ServerConfig;
+
+static ServerConfig g_config = {.backend = BACKEND_IO_URING,
+                                .echo_mode = ECHO_CLASSIC,
+                                .buf_ring_entries = DEFAULT_BUF_RING_ENTRIES,
+                                .buf_size = BUFFER_SIZE,
+                                .sqpoll_idle_ms = DEFAULT_SQPOLL_IDLE_MS,
+                                .min_batch = 1,
+                                .batch_wait_us = DEFAULT_BATCH_WAIT_US,
+                                .link_depth = DEFAULT_LINK_DEPTH,
+                                .pipe_pool = DEFAULT_PIPE_POOL,
+                                .pipeline_depth = DEFAULT_PIPELINE_DEPTH,
+                                .max_msg = DEFAULT_MAX_MSG,
+                                .slab_objects = DEFAULT_SLAB_OBJECTS,
+                                .migrate_threshold = DEFAULT_MIGRATE_THRESHOLD,
+                                .migrate_interval_ms = DEFAULT_MIGRATE_INTERVAL_MS};
+
+#define ZC_ENABLED() (g_config.zc_threshold > 0 || g_config.zc_auto)
+
 static int g_worker_count = 0;
 
 typedef struct {
@@ -59,25 +464,183 @@ typedef struct {
     long long total_requests;
     long long total_bytes_recv;
     long long total_bytes_sent;
+    long long buf_ring_exhausted;  // multishot recv 因 buffer ring 耗尽 (-ENOBUFS) 而终止的次数
+    long long zc_sends;            // 走 SEND_ZC 的发送次数
+    long long zc_copied;           // 内核回退为拷贝的零拷贝发送 (如 loopback)
+    long long submit_calls;        // 有待提交 SQE 的 io_uring_submit 调用次数
+    long long submit_skipped;      // SQPOLL 线程在线，无需 io_uring_enter 的提交次数
+    long long loop_iterations;     // 处理过 CQE 的事件循环轮数
+    long long cqes_processed;
+    long long link_chains;         // linked 模式提交的链数
+    long long link_breaks;         // 因短读断开的链数 (消息长度与 msg_len 不一致)
+    long long pipe_pool_misses;    // splice 模式下 pipe 池为空、建连时现场 pipe2 的次数
+    long long pipeline_writes;     // pipelined 模式提交的 writev 数
+    long long pipeline_iovecs;     // 这些 writev 合并的槽位总数
+    long long pipeline_stalls;     // 槽位全部占满、暂停读取的次数
+    long long short_writes;        // 写出字节数少于请求长度、需要重新提交剩余部分的次数
+    long long stream_writes;       // stream 模式提交的 writev 数
+    long long stream_iovecs;       // 这些 writev 覆盖的块总数
+    long long stream_stalls;       // 未回显数据达到 max_msg、暂停读取的次数
+    long long framed_writes;       // framed 模式提交的 write 数 (帧数即 total_requests)
+    long long framed_compacts;     // 把未收齐的帧搬到缓冲区开头的次数
+    long long framed_compact_bytes;
+    long long framed_errors;       // 帧长超过 buf_size 而关闭的连接数
+    long long framed_delay_us;     // 各帧从客户端发出到服务端解析出的时延之和 (同机或时钟同步时有意义)
+    long long coalesce_flushes;    // 推迟到 CQE 批次末尾提交的写
+    long long coalesce_msg_more;   // 带 MSG_MORE 提交的写 (framed 模式还有未收齐的帧，回显随后就到)
+    long long coalesce_switches;   // 连接在交互式 / 流水线两种状态之间切换的次数
+    long long coalesce_batched;    // 当前处于流水线状态的连接数
+    long long sockopt_failed;      // TCP_NODELAY / TCP_QUICKACK 设置失败的次数
+    long long sq_full;             // io_uring_get_sqe 返回 NULL (或放不下整条链) 的次数
+    long long sq_deferred;         // 写入延迟队列的 SQE 数
+    long long cq_overflow;         // 观察到 CQ 溢出积压 (IORING_SQ_CQ_OVERFLOW 或提交返回 -EBUSY) 的次数
+    long long spin_hits;           // 自旋期间等到 CQE、省去一次阻塞等待的次数
+    long long spin_misses;         // 自旋超时后仍需阻塞等待的次数
+    long long spin_us;             // 自旋消耗的总时长
+    long long blocking_waits;      // 进入内核阻塞等待 CQE 的次数 (含 DEFER_TASKRUN 的 submit_and_wait)
+    long long steal_requests;      // 本 Worker 向最忙的 Worker 发起窃取的次数
+    long long migrations_out;      // 移交给其他 Worker 的连接数
+    long long migrations_in;       // 从其他 Worker 接收的连接数
+    long long migrate_failed;      // MSG_RING 移交失败、连接留在本 Worker 的次数
+    long long idle_timeouts;       // 因空闲超时关闭的连接数
+    long long write_timeouts;      // 因写阻塞超时关闭的连接数
+    long long udp_rx;              // 收到的 UDP 数据报数 (GRO 合并的按段计)
+    long long udp_tx;              // 发回的 UDP 数据报数
+    long long udp_rx_bytes;
+    long long udp_tx_bytes;
+    long long udp_batches;         // 收到数据的 recvmmsg 调用次数
+    long long udp_gro_msgs;        // 内核合并交付 (含多个数据报) 的接收消息数
+    long long udp_gso_msgs;        // 带 UDP_SEGMENT 发出 (含多个数据报) 的发送消息数
+    long long udp_dropped;         // 截断或发送失败而丢弃的数据报数
+    long long unix_connections;    // 经 Unix 域 socket 接受的连接数 (已计入 total_connections)
+    long long tls_handshakes;      // 完成握手 (kTLS 模式下还完成密钥安装) 的连接数
+    long long tls_failed;          // 握手 (含超时) 或 kTLS 安装失败而关闭的连接数
+    long long tls_timeouts;        // 其中握手超过 TLS_HANDSHAKE_TIMEOUT_MS 的连接数
+    long long tls_pending;         // 正在握手的连接数
+    long long tls_handshake_us;    // 成功握手的耗时累计 (逐连接的分布见 WorkerContext.lat_tls)
+    // 以下是发布时刻的瞬时量，Worker 在 worker_publish_stats 中填入，与上面的计数来自同一份快照
+    long long conn_in_use;         // 连接对象池: 已分配、历史峰值、池耗尽后回退到 malloc 的次数
+    long long conn_high_water;
+    long long conn_fallback;
+    long long chunk_in_use;        // 数据块池 (stream/sparse 模式): 同上
+    long long chunk_high_water;
+    long long chunk_fallback;
+    long long deferred_now;        // SQ 延迟队列中等待搬运的 SQE 数与历史峰值
+    long long deferred_peak;
+    long long cq_dropped;          // 内核 CQ 溢出时丢弃的 CQE 数 (*cq.koverflow)
+    long long spin_cur_us;         // 当前自旋时长
     char padding[64];
 } __attribute__((aligned(64))) ThreadStats;
 
+// 控制线程读取的统计快照: Worker 每轮事件循环结束时在顺序锁保护下整体复制 stats，
+// 控制线程拿到的各计数来自同一时刻，不会一部分是新值、一部分是旧值
+typedef struct {
+    SeqLock lock;
+    ThreadStats stats;
+} StatsSnapshot;
+
+#define STATS_WORDS (offsetof(ThreadStats, padding) / sizeof(long long))
+
+// 零拷贝交叉点测量：按发送长度分档，分别统计 copy([0]) / zc([1]) 两条路径
+// 每个采样窗口结束时，把窗口内线程 CPU 时间按字节比例分摊到各档
 typedef struct {
+    long long ops[2][ZC_SIZE_CLASSES];
+    long long bytes[2][ZC_SIZE_CLASSES];
+    long long cpu_ns[2][ZC_SIZE_CLASSES];
+    long long win_bytes[2][ZC_SIZE_CLASSES];
+    long long win_start_us;
+    long long win_cpu_start_ns;
+    int probe_zc;  // auto 模式: 当前窗口使用的发送路径
+} ZcStats;
+
+// 每个 Worker 的上下文独占整页: 可以按页绑定到 Worker 所在的 NUMA 节点，相邻 Worker 的统计字段也不会伪共享
+typedef struct __attribute__((aligned(4096))) {
     int thread_id;
+    int cpu;               // 拓扑规划分配的 CPU
+    int node;              // 该 CPU 所在的 NUMA 节点
     struct io_uring ring;  // 每个线程一个 io_uring 实例
     pthread_t thread_handle;
     ThreadStats stats;
+    StatsSnapshot published;  // stats 的快照，只有控制线程读取
+    long long published_us;   // 上次发布快照的时间 (CLOCK_MONOTONIC_COARSE)
+    int stats_dirty;          // stats 在上次发布后有变化 (跳过了发布)
+
+    // multishot 模式: Worker 内所有连接共享的 provided buffer ring
+    struct io_uring_buf_ring *buf_ring;
+    char *buf_base;          // buf_ring_entries * buf_size 的连续内存
+    BufContext *send_ctxs;   // 按 bid 索引的发送上下文
+    unsigned bufs_held;      // 已被 recv 取走、尚未归还的 buffer 数
+    RecvConn *starved_head;  // 因 -ENOBUFS 暂停接收的连接，有 buffer 归还后在批次末尾重新挂载 recv
+    RecvConn *starved_tail;
+
+    ZcStats zc;
+
+    IoHeader close_ctx;  // fixed file 模式下 close_direct / shutdown 的 user_data (仅失败时产生 CQE)
+
+    // splice 模式: 空闲 pipe 栈，每项两个 fd
+    int *pipe_pool;
+    unsigned pipe_pool_count;
+
+    SlabPool conn_pool;   // 每连接上下文 (IoContext/RecvConn/LinkConn/SpliceConn/PipelineConn/StreamConn) 的对象池
+    SlabPool chunk_pool;  // stream 模式: 所有连接共享的数据块池；sparse 模式: 共享的 buf_size 数据缓冲区池
+
+    // SQ 背压: SQ 满时新的 SQE 写入延迟队列，保持提交顺序
+    DeferredSqe *deferred;
+    unsigned deferred_head;
+    unsigned deferred_tail;
+    unsigned deferred_cap;
+    unsigned deferred_peak;
+    unsigned chain_pending;  // sq_reserve 判定放不下后，本条链还需写入延迟队列的 SQE 数
+    unsigned chain_len;
+
+    unsigned spin_cur_us;  // 当前自旋时长: 命中时翻倍、超时时减半，上限为 spin_us
+    int napi;              // ring 已注册 NAPI busy poll
+
+    // 连接迁移: 其他 Worker 会原子读写 window_load / steal_to
+    IoHeader adopt_hdr;          // 其他 Worker 经 MSG_RING 移交连接时，本 ring 上 CQE 的 user_data
+    long long window_start_us;   // 当前负载窗口的起点
+    long long window_base_reqs;  // 窗口起点时的 total_requests
+    long long window_load;       // 上一个窗口处理的请求数
+    int steal_to;                // 请求本 Worker 迁出一个连接的 Worker 编号 + 1，0 表示没有
+
+    TimerWheel timers;  // 连接超时 (仅在配置了超时时初始化)
+    UdpState *udp;      // UDP 回显 (仅 --udp)
+    IoHeader udp_hdr;   // UDP socket multishot poll 的 user_data
+    long long now_us;   // 本轮事件循环等待返回的时间，连接超时以它为基准
+    CoalesceNode *flush_head;  // --coalesce: 本批 CQE 中推迟写出的连接
+    long long loop_ns;         // --latency: 本轮等待返回的时间 (单调时钟)
+    Histogram lat_service;     // 请求从 READ CQE 到最后一个 WRITE CQE 被收割的时间 (ns)
+    Histogram lat_loop;        // 每轮从等待返回到处理完全部 CQE 并提交的时间 (ns)，即批内 CQE 最长的等待
+
+#ifdef ENABLE_EBPF
+    struct reuseport_load *lb_load;  // reuseport 分派读取的负载槽位 (BPF map 映射到用户态)
+#endif
+#ifdef ENABLE_TLS
+    char *tls_plain;      // --tls user: 解密出的明文暂存区 (buf_size 字节)
+    TimerWheel tls_timers;  // 握手超时 (与连接超时分开，不依赖 --idle-timeout)
+    Histogram lat_tls;      // 每个连接从 accept 到握手结束 (成功、失败或超时) 的时间 (ns)，不需要 --latency
+#endif
 } WorkerContext;
 
 static volatile int running = 1;
 static Logger *g_logger = NULL;
 static Monitor *g_monitor = NULL;
 static WorkerContext *g_workers = NULL;
+static Topology g_topology;
 static long long g_start_time_us = 0;
+static long long g_start_segs[2] = {0, 0};  // 启动时系统累计的 TCP 收/发段数与网络软中断数，stats 据此算每请求开销
+static long long g_start_softirqs = 0;
+static int g_unix_listen_fd = -1;  // 所有 Worker 共享的 Unix 域监听 socket (AF_UNIX 没有 SO_REUSEPORT)
 
 #ifdef ENABLE_EBPF
 static sockmap_loader_t *g_sockmap = NULL;
+static reuseport_loader_t *g_reuseport = NULL;
 #define EBPF_OBJ_PATH "./out/ebpf/sockmap.bpf.o"
+#define REUSEPORT_OBJ_PATH "./out/ebpf/reuseport.bpf.o"
+#endif
+
+#ifdef ENABLE_TLS
+static SSL_CTX *g_tls_ctx = NULL;
 #endif
 
 // ==========================================
@@ -116,54 +679,462 @@ int set_reuseport(int fd) {
     return setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
 }
 
+// 返回集合中第 n 个 (从 0 开始) CPU 编号
+static int cpu_set_nth(const cpu_set_t *set, int n) {
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, set) && n-- == 0)
+            return cpu;
+    }
+    return -1;
+}
+
+// ==========================================
+// SQ 提交与背压
+// ==========================================
+
+// 提交本轮积累的 SQE
+// SQPOLL 模式下内核线程在线时 io_uring_submit 只更新 SQ tail，线程休眠
+// (IORING_SQ_NEED_WAKEUP) 时才需要 io_uring_enter 唤醒它
+// CQ 溢出积压时内核会以 -EBUSY 拒绝提交，SQE 留在 SQ 中，收割 CQE 后下一轮再提交
+static void worker_submit(WorkerContext *ctx) {
+    if (io_uring_sq_ready(&ctx->ring) == 0)
+        return;
+    ctx->stats.submit_calls++;
+    if (g_config.sqpoll && !(__atomic_load_n(ctx->ring.sq.kflags, __ATOMIC_ACQUIRE) & IORING_SQ_NEED_WAKEUP))
+        ctx->stats.submit_skipped++;
+    if (io_uring_submit(&ctx->ring) == -EBUSY)
+        ctx->stats.cq_overflow++;
+}
+
+// 保证延迟队列尾部还能追加 n 项：先把已搬走的队首空间压缩掉，仍不够时翻倍扩容
+static int sq_defer_grow(WorkerContext *ctx, unsigned n) {
+    if (ctx->deferred_tail + n <= ctx->deferred_cap)
+        return 0;
+    if (ctx->deferred_head > 0) {
+        memmove(ctx->deferred, ctx->deferred + ctx->deferred_head,
+                (ctx->deferred_tail - ctx->deferred_head) * sizeof(DeferredSqe));
+        ctx->deferred_tail -= ctx->deferred_head;
+        ctx->deferred_head = 0;
+    }
+    unsigned cap = ctx->deferred_cap ? ctx->deferred_cap : DEFERRED_SQE_INIT;
+    while (ctx->deferred_tail + n > cap)
+        cap *= 2;
+    if (cap != ctx->deferred_cap) {
+        DeferredSqe *queue = realloc(ctx->deferred, cap * sizeof(DeferredSqe));
+        if (!queue)
+            return -ENOMEM;
+        ctx->deferred = queue;
+        ctx->deferred_cap = cap;
+    }
+    return 0;
+}
+
+// 在延迟队列尾部追加一个 SQE 槽位
+static struct io_uring_sqe *sq_defer_push(WorkerContext *ctx, unsigned chain) {
+    if (sq_defer_grow(ctx, 1) < 0)
+        return NULL;
+
+    DeferredSqe *d = &ctx->deferred[ctx->deferred_tail++];
+    memset(&d->sqe, 0, sizeof(d->sqe));
+    d->chain = chain;
+    ctx->stats.sq_deferred++;
+    if (ctx->deferred_tail - ctx->deferred_head > ctx->deferred_peak)
+        ctx->deferred_peak = ctx->deferred_tail - ctx->deferred_head;
+    return &d->sqe;
+}
+
+// 取一个 SQE
+// SQ 满时先提交一次腾出空间；仍然没有空间 (如 SQPOLL 线程尚未消费) 或延迟队列非空时写入延迟队列，
+// 保证 SQE 的提交顺序不变。只有延迟队列扩容失败时才返回 NULL
+static struct io_uring_sqe *sq_get_sqe(WorkerContext *ctx) {
+    if (ctx->chain_pending > 0) {
+        unsigned chain = ctx->chain_pending == ctx->chain_len ? ctx->chain_len : 0;
+        ctx->chain_pending--;
+        return sq_defer_push(ctx, chain);
+    }
+    if (ctx->deferred_head == ctx->deferred_tail) {
+        struct io_uring_sqe *sqe = io_uring_get_sqe(&ctx->ring);
+        if (!sqe) {
+            ctx->stats.sq_full++;
+            worker_submit(ctx);
+            sqe = io_uring_get_sqe(&ctx->ring);
+        }
+        if (sqe)
+            return sqe;
+    }
+    return sq_defer_push(ctx, 1);
+}
+
+// 为一条 n 个 SQE 的链预留空间，成功后接下来 n 次 sq_get_sqe 一定不会返回 NULL
+// 链必须整条进入 SQ，否则最后一个带 IO_LINK 的 SQE 会把其他连接的 SQE 串进来；
+// 放不下时整条链进入延迟队列 (预先扩容，避免只写入半条链)
+static int sq_reserve(WorkerContext *ctx, unsigned n) {
+    if (ctx->deferred_head == ctx->deferred_tail) {
+        if (io_uring_sq_space_left(&ctx->ring) >= n)
+            return 0;
+        ctx->stats.sq_full++;
+        worker_submit(ctx);
+        if (io_uring_sq_space_left(&ctx->ring) >= n)
+            return 0;
+    }
+    if (sq_defer_grow(ctx, n) < 0)
+        return -ENOMEM;
+    ctx->chain_pending = n;
+    ctx->chain_len = n;
+    return 0;
+}
+
+// 把延迟队列中的 SQE 按顺序搬进 SQ，遇到放不下的 (整条) 链时停止
+static void sq_flush_deferred(WorkerContext *ctx) {
+    while (ctx->deferred_head < ctx->deferred_tail) {
+        unsigned n = ctx->deferred[ctx->deferred_head].chain;
+        if (io_uring_sq_space_left(&ctx->ring) < n || ctx->deferred_tail - ctx->deferred_head < n)
+            break;
+        for (unsigned i = 0; i < n; i++) {
+            struct io_uring_sqe *sqe = io_uring_get_sqe(&ctx->ring);
+            *sqe = ctx->deferred[ctx->deferred_head++].sqe;
+        }
+    }
+    if (ctx->deferred_head == ctx->deferred_tail)
+        ctx->deferred_head = ctx->deferred_tail = 0;
+}
+
 // ==========================================
 // io_uring 辅助函数
 // ==========================================
 
+// 连接的 SQE 在 fixed file 模式下引用的是文件表槽位，省去每次操作的 fget/fput
+static inline void sqe_set_conn_file(struct io_uring_sqe *sqe) {
+    if (g_config.fixed_files)
+        sqe->flags |= IOSQE_FIXED_FILE;
+}
+
 // 准备 Accept 请求
-void add_accept_request(struct io_uring *ring, int server_fd, struct sockaddr *client_addr, socklen_t *client_len,
+void add_accept_request(WorkerContext *worker, int server_fd, struct sockaddr *client_addr, socklen_t *client_len,
                         IoContext *ctx) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
-    // 如果 SQ 满了，sqe 可能为 NULL，生产环境需要处理这种情况（通常是提交并重试）
+    struct io_uring_sqe *sqe = sq_get_sqe(worker);
+    // SQ 满时 sq_get_sqe 返回延迟队列中的槽位，只有延迟队列扩容失败才会是 NULL
+    if (!sqe)
+        return;
+
+    // fixed file 模式下直接 accept 到 ring 的文件表中，CQE 返回槽位号而不是 fd
+    if (g_config.fixed_files)
+        io_uring_prep_accept_direct(sqe, server_fd, client_addr, client_len, 0, IORING_FILE_INDEX_ALLOC);
+    else
+        io_uring_prep_accept(sqe, server_fd, client_addr, client_len, 0);
+    ctx->hdr.fd = server_fd;
+    ctx->hdr.type = EVENT_ACCEPT;
+    io_uring_sqe_set_data(sqe, ctx);
+}
+
+// 准备 multishot Accept 请求：一次提交，每个新连接产生一个 CQE (带 IORING_CQE_F_MORE)
+void add_multishot_accept_request(WorkerContext *worker, int server_fd, IoContext *ctx) {
+    struct io_uring_sqe *sqe = sq_get_sqe(worker);
     if (!sqe)
         return;
 
-    io_uring_prep_accept(sqe, server_fd, client_addr, client_len, 0);
-    ctx->fd = server_fd;
-    ctx->type = EVENT_ACCEPT;
+    if (g_config.fixed_files)
+        io_uring_prep_multishot_accept_direct(sqe, server_fd, NULL, NULL, 0);
+    else
+        io_uring_prep_multishot_accept(sqe, server_fd, NULL, NULL, 0);
+    ctx->hdr.fd = server_fd;
+    ctx->hdr.type = EVENT_ACCEPT;
     io_uring_sqe_set_data(sqe, ctx);
 }
 
+// ==========================================
+// 连接超时
+// ==========================================
+// 每个连接一个定时器节点: 读 (或 poll) 在途时按空闲超时计时，写在途时按写阻塞超时计时，
+// 每次发起 I/O 都刷新到期时间。到期的连接由 conn_timer_expire 关闭，统计计入 idle/write_timeouts
+#define TIMEOUTS_ENABLED() (g_config.idle_timeout_ms || g_config.write_timeout_ms)
+
+static inline void conn_timer_arm(WorkerContext *ctx, TimerNode *timer, int writing) {
+    if (!TIMEOUTS_ENABLED())
+        return;
+    unsigned ms = writing ? g_config.write_timeout_ms : g_config.idle_timeout_ms;
+    if (ms)
+        timer_wheel_arm(&ctx->timers, timer, ctx->now_us + (long long)ms * 1000);
+    else
+        timer_wheel_cancel(&ctx->timers, timer);
+}
+
+static inline void conn_timer_cancel(WorkerContext *ctx, TimerNode *timer) {
+    if (TIMEOUTS_ENABLED())
+        timer_wheel_cancel(&ctx->timers, timer);
+}
+
 // 准备 Read 请求
-void add_read_request(struct io_uring *ring, int client_fd, IoContext *ctx) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+void add_read_request(WorkerContext *worker, int client_fd, IoContext *ctx) {
+    struct io_uring_sqe *sqe = sq_get_sqe(worker);
     if (!sqe)
         return;
 
     ctx->iov.iov_base = ctx->buffer;
-    ctx->iov.iov_len = BUFFER_SIZE;
-    ctx->fd = client_fd;
-    ctx->type = EVENT_READ;
+    ctx->iov.iov_len = g_config.buf_size;
+    ctx->hdr.fd = client_fd;
+    ctx->hdr.type = EVENT_READ;
 
     io_uring_prep_readv(sqe, client_fd, &ctx->iov, 1, 0);
+    sqe_set_conn_file(sqe);
     io_uring_sqe_set_data(sqe, ctx);
+    conn_timer_arm(worker, &ctx->timer, 0);
 }
 
-// 准备 Write 请求
-void add_write_request(struct io_uring *ring, int client_fd, IoContext *ctx, size_t len) {
-    struct io_uring_sqe *sqe = io_uring_get_sqe(ring);
+// 准备 Write 请求，发送 buffer[off, off + len)；zero_copy 时改用 SEND_ZC，完成后还会多一个通知 CQE
+void add_write_request(WorkerContext *worker, int client_fd, IoContext *ctx, size_t off, size_t len, int zero_copy) {
+    struct io_uring_sqe *sqe = sq_get_sqe(worker);
     if (!sqe)
         return;
 
-    ctx->iov.iov_base = ctx->buffer;
+    ctx->iov.iov_base = ctx->buffer + off;
     ctx->iov.iov_len = len;
-    ctx->fd = client_fd;
-    ctx->type = EVENT_WRITE;
+    ctx->hdr.fd = client_fd;
+    ctx->hdr.type = EVENT_WRITE;
+
+    if (zero_copy)
+        io_uring_prep_send_zc(sqe, client_fd, ctx->iov.iov_base, len, MSG_WAITALL, IORING_SEND_ZC_REPORT_USAGE);
+    else
+        io_uring_prep_writev(sqe, client_fd, &ctx->iov, 1, 0);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, ctx);
+    conn_timer_arm(worker, &ctx->timer, 1);
+}
+
+// 准备 multishot Recv 请求：不指定缓冲区，由内核从 buffer ring 中挑选
+void add_multishot_recv_request(WorkerContext *worker, int client_fd, RecvConn *ctx) {
+    struct io_uring_sqe *sqe = sq_get_sqe(worker);
+    if (!sqe)
+        return;
+
+    ctx->hdr.fd = client_fd;
+    ctx->hdr.type = EVENT_RECV;
+
+    io_uring_prep_recv_multishot(sqe, client_fd, NULL, 0, 0);
+    sqe->flags |= IOSQE_BUFFER_SELECT;
+    sqe->buf_group = BUF_GROUP_ID;
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, ctx);
+}
+
+// 准备 Send 请求：直接从 provided buffer 回显，MSG_WAITALL 让内核处理短写
+void add_send_buffer_request(WorkerContext *worker, int client_fd, BufContext *ctx, const void *buf, size_t len,
+                             int zero_copy) {
+    struct io_uring_sqe *sqe = sq_get_sqe(worker);
+    if (!sqe)
+        return;
+
+    ctx->hdr.fd = client_fd;
+    ctx->hdr.type = EVENT_SEND;
+
+    if (zero_copy)
+        io_uring_prep_send_zc(sqe, client_fd, buf, len, MSG_WAITALL, IORING_SEND_ZC_REPORT_USAGE);
+    else
+        io_uring_prep_send(sqe, client_fd, buf, len, MSG_WAITALL);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, ctx);
+}
+
+// 关闭 fixed file 槽位，成功时不产生 CQE
+void add_close_direct_request(WorkerContext *worker, int slot, IoHeader *ctx) {
+    struct io_uring_sqe *sqe = sq_get_sqe(worker);
+    if (!sqe)
+        return;
 
-    io_uring_prep_writev(sqe, client_fd, &ctx->iov, 1, 0);
+    io_uring_prep_close_direct(sqe, slot);
+    sqe->flags |= IOSQE_CQE_SKIP_SUCCESS;
     io_uring_sqe_set_data(sqe, ctx);
 }
 
+// ==========================================
+// Provided buffer ring
+// ==========================================
+
+static inline char *buf_ring_addr(WorkerContext *ctx, unsigned short bid) {
+    return ctx->buf_base + (size_t)bid * g_config.buf_size;
+}
+
+// 将 buffer 归还给内核，供后续 multishot recv 使用
+static inline void buf_ring_recycle(WorkerContext *ctx, unsigned short bid) {
+    ctx->bufs_held--;
+    io_uring_buf_ring_add(ctx->buf_ring, buf_ring_addr(ctx, bid), g_config.buf_size, bid,
+                          io_uring_buf_ring_mask(g_config.buf_ring_entries), 0);
+    io_uring_buf_ring_advance(ctx->buf_ring, 1);
+}
+
+// 注册 Worker 的 provided buffer ring，并把所有 buffer 交给内核
+int buf_ring_setup(WorkerContext *ctx) {
+    unsigned entries = g_config.buf_ring_entries;
+    int ret;
+
+    if (posix_memalign((void **)&ctx->buf_base, 4096, (size_t)entries * g_config.buf_size) != 0)
+        return -ENOMEM;
+    ctx->send_ctxs = calloc(entries, sizeof(BufContext));
+    if (!ctx->send_ctxs)
+        return -ENOMEM;
+
+    ctx->buf_ring = io_uring_setup_buf_ring(&ctx->ring, entries, BUF_GROUP_ID, 0, &ret);
+    if (!ctx->buf_ring)
+        return ret;
+
+    int mask = io_uring_buf_ring_mask(entries);
+    for (unsigned i = 0; i < entries; i++) {
+        ctx->send_ctxs[i].bid = i;
+        io_uring_buf_ring_add(ctx->buf_ring, buf_ring_addr(ctx, i), g_config.buf_size, i, mask, i);
+    }
+    io_uring_buf_ring_advance(ctx->buf_ring, entries);
+    return 0;
+}
+
+void buf_ring_destroy(WorkerContext *ctx) {
+    if (ctx->buf_ring)
+        io_uring_free_buf_ring(&ctx->ring, ctx->buf_ring, g_config.buf_ring_entries, BUF_GROUP_ID);
+    free(ctx->send_ctxs);
+    free(ctx->buf_base);
+    ctx->buf_ring = NULL;
+    ctx->send_ctxs = NULL;
+    ctx->buf_base = NULL;
+}
+
+// ==========================================
+// Pipe 池 (splice 模式)
+// ==========================================
+
+// 创建一个 pipe；缓冲区大于 pipe 默认容量时扩容，保证一次 splice 能装下 buf_size 字节
+static int pipe_create(int fds[2]) {
+    if (pipe2(fds, O_CLOEXEC) < 0)
+        return -1;
+    if (g_config.buf_size > PIPE_DEFAULT_SIZE)
+        fcntl(fds[1], F_SETPIPE_SZ, g_config.buf_size);
+    return 0;
+}
+
+// 从池中取一个 pipe，池空时现场创建
+static int pipe_acquire(WorkerContext *ctx, int fds[2]) {
+    if (ctx->pipe_pool_count > 0) {
+        ctx->pipe_pool_count--;
+        fds[0] = ctx->pipe_pool[2 * ctx->pipe_pool_count];
+        fds[1] = ctx->pipe_pool[2 * ctx->pipe_pool_count + 1];
+        return 0;
+    }
+    ctx->stats.pipe_pool_misses++;
+    return pipe_create(fds);
+}
+
+// 归还 pipe；pipe 中可能残留数据 (clean == 0) 或池已满时直接关闭
+static void pipe_release(WorkerContext *ctx, int fds[2], int clean) {
+    if (clean && ctx->pipe_pool_count < g_config.pipe_pool) {
+        ctx->pipe_pool[2 * ctx->pipe_pool_count] = fds[0];
+        ctx->pipe_pool[2 * ctx->pipe_pool_count + 1] = fds[1];
+        ctx->pipe_pool_count++;
+        return;
+    }
+    close(fds[0]);
+    close(fds[1]);
+}
+
+int pipe_pool_setup(WorkerContext *ctx) {
+    ctx->pipe_pool = malloc(2 * sizeof(int) * (g_config.pipe_pool ? g_config.pipe_pool : 1));
+    if (!ctx->pipe_pool)
+        return -ENOMEM;
+    while (ctx->pipe_pool_count < g_config.pipe_pool) {
+        int *fds = &ctx->pipe_pool[2 * ctx->pipe_pool_count];
+        if (pipe_create(fds) < 0)
+            return -errno;
+        ctx->pipe_pool_count++;
+    }
+    return 0;
+}
+
+void pipe_pool_destroy(WorkerContext *ctx) {
+    for (unsigned i = 0; i < 2 * ctx->pipe_pool_count; i++)
+        close(ctx->pipe_pool[i]);
+    free(ctx->pipe_pool);
+    ctx->pipe_pool = NULL;
+    ctx->pipe_pool_count = 0;
+}
+
+// ==========================================
+// 零拷贝发送 (IORING_OP_SEND_ZC)
+// ==========================================
+
+static inline int zc_size_class(size_t len) {
+    int cls = 0;
+    while (cls < ZC_SIZE_CLASSES - 1 && (len >> (ZC_MIN_SHIFT + cls + 1)) > 0)
+        cls++;
+    return cls;
+}
+
+// 决定本次回显的发送路径并记录到当前采样窗口
+static int zc_select(WorkerContext *ctx, size_t len) {
+    if (!ZC_ENABLED())
+        return 0;
+
+    int zero_copy = g_config.zc_auto ? ctx->zc.probe_zc : len >= g_config.zc_threshold;
+    int cls = zc_size_class(len);
+    ctx->zc.ops[zero_copy][cls]++;
+    ctx->zc.win_bytes[zero_copy][cls] += len;
+    if (zero_copy)
+        ctx->stats.zc_sends++;
+    return zero_copy;
+}
+
+// 采样窗口到期时按字节比例分摊线程 CPU 时间；auto 模式下同时切换发送路径
+static void zc_window_tick(WorkerContext *ctx) {
+    long long now_us = monitor_get_time_us();
+    if (now_us - ctx->zc.win_start_us < ZC_PROBE_WINDOW_US)
+        return;
+
+    long long cpu_ns = monitor_get_thread_cpu_ns();
+    long long cpu_delta = cpu_ns - ctx->zc.win_cpu_start_ns;
+    long long total = 0;
+    for (int p = 0; p < 2; p++)
+        for (int c = 0; c < ZC_SIZE_CLASSES; c++)
+            total += ctx->zc.win_bytes[p][c];
+
+    if (total > 0) {
+        for (int p = 0; p < 2; p++) {
+            for (int c = 0; c < ZC_SIZE_CLASSES; c++) {
+                long long b = ctx->zc.win_bytes[p][c];
+                if (b == 0)
+                    continue;
+                ctx->zc.cpu_ns[p][c] += (long long)((double)cpu_delta * b / total);
+                ctx->zc.bytes[p][c] += b;
+                ctx->zc.win_bytes[p][c] = 0;
+            }
+        }
+    }
+
+    ctx->zc.win_start_us = now_us;
+    ctx->zc.win_cpu_start_ns = cpu_ns;
+    if (g_config.zc_auto)
+        ctx->zc.probe_zc = !ctx->zc.probe_zc;
+}
+
+// 汇总所有 Worker，返回零拷贝每 KB CPU 开销低于拷贝的最小分档长度，样本不足时返回 -1
+static long long zc_crossover(ZcStats *total) {
+    memset(total, 0, sizeof(*total));
+    for (int i = 0; i < g_worker_count; i++) {
+        for (int p = 0; p < 2; p++) {
+            for (int c = 0; c < ZC_SIZE_CLASSES; c++) {
+                total->ops[p][c] += g_workers[i].zc.ops[p][c];
+                total->bytes[p][c] += g_workers[i].zc.bytes[p][c];
+                total->cpu_ns[p][c] += g_workers[i].zc.cpu_ns[p][c];
+            }
+        }
+    }
+
+    for (int c = 0; c < ZC_SIZE_CLASSES; c++) {
+        if (total->bytes[0][c] < ZC_MIN_SAMPLE_BYTES || total->bytes[1][c] < ZC_MIN_SAMPLE_BYTES)
+            continue;
+        double copy_cost = (double)total->cpu_ns[0][c] / total->bytes[0][c];
+        double zc_cost = (double)total->cpu_ns[1][c] / total->bytes[1][c];
+        if (zc_cost < copy_cost)
+            return 1LL << (ZC_MIN_SHIFT + c);
+    }
+    return -1;
+}
+
 // ==========================================
 // Socket 创建
 // ==========================================
@@ -180,6 +1151,29 @@ int create_listener() {
     int flags = fcntl(fd, F_GETFL, 0);
     fcntl(fd, F_SETFL, flags | O_NONBLOCK);
 
+    // 缓冲区上限在 listen 之前设置，accept 出的连接继承，窗口扩大因子也按该上限协商
+    if (g_config.rcvbuf && setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &g_config.rcvbuf, sizeof(g_config.rcvbuf)) < 0) {
+        close(fd);
+        return -1;
+    }
+    if (g_config.sndbuf && setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &g_config.sndbuf, sizeof(g_config.sndbuf)) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    // busy poll 参数同样由新连接继承；超过 sysctl 设定值需要 CAP_NET_ADMIN，失败时只告警
+    if (g_config.busy_poll_us) {
+        int val = g_config.busy_poll_us;
+        if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &val, sizeof(val)) < 0)
+            LOG_WARN(g_logger, "设置 SO_BUSY_POLL 失败: %s", strerror(errno));
+        val = g_config.prefer_busy_poll;
+        if (val && setsockopt(fd, SOL_SOCKET, SO_PREFER_BUSY_POLL, &val, sizeof(val)) < 0)
+            LOG_WARN(g_logger, "设置 SO_PREFER_BUSY_POLL 失败: %s", strerror(errno));
+        val = g_config.busy_poll_budget;
+        if (val && setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL_BUDGET, &val, sizeof(val)) < 0)
+            LOG_WARN(g_logger, "设置 SO_BUSY_POLL_BUDGET 失败: %s", strerror(errno));
+    }
+
     struct sockaddr_in addr;
     memset(&addr, 0, sizeof(addr));
     addr.sin_family = AF_INET;
@@ -198,142 +1192,2610 @@ int create_listener() {
     return fd;
 }
 
-// ==========================================
-// 工作线程 (Worker) - io_uring 核心循环
-// ==========================================
-void *worker_routine(void *arg) {
-    WorkerContext *ctx = (WorkerContext *)arg;
-    int thread_id = ctx->thread_id;
-
-    // 1. CPU 亲和性
-    cpu_set_t cpuset;
-    CPU_ZERO(&cpuset);
-    int cpu_count = monitor_get_cpu_count();
-    int cpu_id = thread_id % cpu_count;
-    CPU_SET(cpu_id, &cpuset);
-    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
-    LOG_INFO(g_logger, "[Worker %d] 绑定 CPU %d", thread_id, cpu_id);
-
-    // 2. 初始化 io_uring
-    if (io_uring_queue_init(QUEUE_DEPTH, &ctx->ring, 0) < 0) {
-        LOG_ERROR(g_logger, "[Worker %d] io_uring_queue_init 失败", thread_id);
-        return NULL;
+// 填充 Unix 域 socket 地址: 以 @ 开头的名字放在抽象命名空间 (sun_path[0] 为 0，不占用文件系统)
+// 返回地址长度，路径过长返回 0
+static socklen_t unix_sockaddr(const char *path, struct sockaddr_un *addr) {
+    size_t len = strlen(path);
+    if (len == 0 || len >= sizeof(addr->sun_path))
+        return 0;
+    memset(addr, 0, sizeof(*addr));
+    addr->sun_family = AF_UNIX;
+    memcpy(addr->sun_path, path, len);
+    if (path[0] == '@') {
+        addr->sun_path[0] = '\0';
+        return offsetof(struct sockaddr_un, sun_path) + len;
     }
+    return sizeof(*addr);
+}
 
-    // 3. 创建监听 Socket
-    int listen_fd = create_listener();
-    if (listen_fd < 0) {
-        LOG_ERROR(g_logger, "[Worker %d] 创建监听 Socket 失败: %s", thread_id, strerror(errno));
-        return NULL;
+// Unix 域监听 socket: 在启动 Worker 之前创建一次，每个 Worker 在同一个 fd 上各挂一个 accept，
+// 由内核把新连接交给其中一个等待者。文件系统路径上残留的旧 socket 文件先删除
+int create_unix_listener(const char *path) {
+    struct sockaddr_un addr;
+    socklen_t addr_len = unix_sockaddr(path, &addr);
+    if (addr_len == 0) {
+        errno = ENAMETOOLONG;
+        return -1;
     }
 
-    // 4. 提交第一个 Accept 请求
-    IoContext *listener_ctx = malloc(sizeof(IoContext));
-    struct sockaddr_in client_addr;
-    socklen_t client_len = sizeof(client_addr);
-    add_accept_request(&ctx->ring, listen_fd, (struct sockaddr *)&client_addr, &client_len, listener_ctx);
-    io_uring_submit(&ctx->ring);
-
-    struct io_uring_cqe *cqe;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (path[0] != '@')
+        unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, addr_len) < 0 || listen(fd, BACKLOG) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// 监听 socket 加入 reuseport 分派；失败时本 Worker 不在 sockarray 中，选中它的连接退回内核哈希
+static void worker_register_listener(WorkerContext *ctx, int listen_fd) {
+#ifdef ENABLE_EBPF
+    if (!g_reuseport)
+        return;
+    int ret = reuseport_loader_add_listener(g_reuseport, ctx->thread_id, listen_fd);
+    if (ret < 0) {
+        LOG_WARN(g_logger, "[Worker %d] 监听 socket 加入 reuseport 分派失败: %s", ctx->thread_id, strerror(-ret));
+        return;
+    }
+    ctx->lb_load = reuseport_loader_load_slot(g_reuseport, ctx->thread_id);
+#else
+    (void)ctx;
+    (void)listen_fd;
+#endif
+}
+
+// 在顺序锁保护下发布 stats 快照: 先把对象池、延迟队列等只有 Worker 能一致读取的瞬时量填入 stats，
+// 控制线程拿到的所有字段都来自同一时刻
+static void worker_publish_stats(WorkerContext *ctx) {
+    ThreadStats *st = &ctx->stats;
+    st->conn_in_use = ctx->conn_pool.in_use;
+    st->conn_high_water = ctx->conn_pool.high_water;
+    st->conn_fallback = ctx->conn_pool.fallback_allocs;
+    st->chunk_in_use = ctx->chunk_pool.in_use;
+    st->chunk_high_water = ctx->chunk_pool.high_water;
+    st->chunk_fallback = ctx->chunk_pool.fallback_allocs;
+    st->deferred_now = ctx->deferred_tail - ctx->deferred_head;
+    st->deferred_peak = ctx->deferred_peak;
+    st->cq_dropped = ctx->ring.cq.koverflow ? *ctx->ring.cq.koverflow : 0;  // epoll 后端没有 ring，为 NULL
+    st->spin_cur_us = ctx->spin_cur_us;
+
+    seqlock_write_begin(&ctx->published.lock);
+    seqlock_copy((long long *)&ctx->published.stats, (const long long *)st, STATS_WORDS);
+    seqlock_write_end(&ctx->published.lock);
+    ctx->stats_dirty = 0;
+}
+
+// 每轮事件循环结束 (含空闲超时) 时发布负载供 reuseport 选择程序读取 (两次存储，每轮都做)。
+// stats 快照每 STATS_PUBLISH_US 最多发布一次: 控制线程每秒才读一次，逐轮整体复制会给被测的每轮开销
+// 加上一笔固定成本。粗粒度时钟由 vDSO 直接读内存，判断本身几乎没有开销
+static inline void worker_publish_load(WorkerContext *ctx, unsigned events) {
+#ifdef ENABLE_EBPF
+    if (ctx->lb_load) {
+        __atomic_store_n(&ctx->lb_load->active, (unsigned)ctx->stats.active_connections, __ATOMIC_RELAXED);
+        __atomic_store_n(&ctx->lb_load->queued, events + ctx->deferred_tail - ctx->deferred_head, __ATOMIC_RELAXED);
+    }
+#else
+    (void)events;
+#endif
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &ts);
+    long long now_us = ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+    if (now_us - ctx->published_us < STATS_PUBLISH_US) {
+        ctx->stats_dirty = 1;
+        return;
+    }
+    ctx->published_us = now_us;
+    worker_publish_stats(ctx);
+}
+
+// ==========================================
+// 工作线程 (Worker) - io_uring 核心循环
+// ==========================================
+
+// 阻塞等待 CQE
+// 默认模式: 上一轮末尾已单独提交，这里只等待 (最多两次 io_uring_enter/轮)
+// DEFER_TASKRUN 模式: 提交、执行 task_work 与等待合并为一次 io_uring_enter，至少凑齐 min_batch 个 CQE；
+//   凑批超时且没有任何 CQE 时视为空闲，下一轮退回到只等 1 个 CQE、超时 1 秒，避免空转
+// 注册了 NAPI 的 ring 在这里阻塞之前由内核先 busy poll 网卡队列
+// 空闲时单次阻塞等待的上限 (毫秒): 开启连接迁移时不超过一个负载窗口，空闲 Worker 才能及时发起窃取；
+// 配置了连接超时 (或 TLS 握手超时) 时不超过最短的超时，空闲 Worker 上的到期连接最多晚一个超时时长被关闭
+static int idle_wait_ms(void) {
+    unsigned ms = g_config.migrate ? g_config.migrate_interval_ms : 1000;
+    if (g_config.idle_timeout_ms && g_config.idle_timeout_ms < ms)
+        ms = g_config.idle_timeout_ms;
+    if (g_config.write_timeout_ms && g_config.write_timeout_ms < ms)
+        ms = g_config.write_timeout_ms;
+#ifdef ENABLE_TLS
+    if (g_config.tls && TLS_HANDSHAKE_TIMEOUT_MS < ms)
+        ms = TLS_HANDSHAKE_TIMEOUT_MS;
+#endif
+    return ms;
+}
+
+// 有尚未发布的 stats 变化时只等一个发布间隔: 刚变为空闲的 Worker 醒来发布最终状态，之后才长时间阻塞
+static int worker_idle_wait_ms(const WorkerContext *ctx) {
+    return ctx->stats_dirty ? STATS_PUBLISH_US / 1000 : idle_wait_ms();
+}
+
+static void idle_timeout(const WorkerContext *ctx, struct __kernel_timespec *ts) {
+    int ms = worker_idle_wait_ms(ctx);
+    ts->tv_sec = ms / 1000;
+    ts->tv_nsec = (ms % 1000) * 1000000LL;
+}
+
+static int worker_wait_blocking(WorkerContext *ctx, struct io_uring_cqe **cqe, int *idle) {
+    struct __kernel_timespec ts;
+    if (!g_config.defer_taskrun) {
+        idle_timeout(ctx, &ts);
+        return io_uring_wait_cqe_timeout(&ctx->ring, cqe, &ts);
+    }
+
+    unsigned wait_nr = *idle ? 1 : g_config.min_batch;
+    if (*idle) {
+        idle_timeout(ctx, &ts);
+    } else {
+        ts.tv_sec = 0;
+        ts.tv_nsec = (long long)g_config.batch_wait_us * 1000;
+    }
+    if (io_uring_sq_ready(&ctx->ring) > 0)
+        ctx->stats.submit_calls++;
+
+    int ret = io_uring_submit_and_wait_timeout(&ctx->ring, cqe, wait_nr, &ts, NULL);
+    if (io_uring_cq_ready(&ctx->ring) > 0) {
+        *idle = 0;
+        return 0;
+    }
+    if (ret == -ETIME)
+        *idle = 1;
+    return ret < 0 ? ret : -ETIME;
+}
+
+// 自适应自旋: 阻塞等待前先在用户态轮询 CQ 最多 spin_cur_us 微秒。
+// 等到 CQE 说明负载足够密集，下次自旋时长翻倍；超时则减半，空闲时很快退化为直接阻塞。
+// 普通 ring 的完成由 task_work 打断自旋线程后写入 CQ；DEFER_TASKRUN 的 task_work 只在进入内核时执行，
+// 因此每次轮询前用 io_uring_get_events 做一次不阻塞的 GETEVENTS
+static int worker_spin(WorkerContext *ctx, struct io_uring_cqe **cqe) {
+    if (g_config.defer_taskrun && io_uring_sq_ready(&ctx->ring) > 0) {
+        ctx->stats.submit_calls++;
+        io_uring_submit(&ctx->ring);
+    }
+
+    long long start = monitor_get_time_us();
+    long long now = start;
+    do {
+        if (g_config.defer_taskrun)
+            io_uring_get_events(&ctx->ring);
+        if (io_uring_peek_cqe(&ctx->ring, cqe) == 0) {
+            ctx->stats.spin_hits++;
+            ctx->stats.spin_us += monitor_get_time_us() - start;
+            ctx->spin_cur_us = ctx->spin_cur_us * 2 > g_config.spin_us ? g_config.spin_us : ctx->spin_cur_us * 2;
+            return 0;
+        }
+        now = monitor_get_time_us();
+    } while (now - start < ctx->spin_cur_us);
+
+    ctx->stats.spin_misses++;
+    ctx->stats.spin_us += now - start;
+    ctx->spin_cur_us /= 2;
+    return -ETIME;
+}
+
+static int worker_wait(WorkerContext *ctx, struct io_uring_cqe **cqe, int *idle) {
+    // 自旋时长已退化为 0 时，阻塞等待很快返回 (小于 spin_us) 说明自旋本可以命中，重新从 1us 开始尝试
+    long long wait_start = 0;
+    if (g_config.spin_us) {
+        if (ctx->spin_cur_us && worker_spin(ctx, cqe) == 0) {
+            *idle = 0;
+            return 0;
+        }
+        wait_start = monitor_get_time_us();
+    }
+    ctx->stats.blocking_waits++;
+
+    int ret = worker_wait_blocking(ctx, cqe, idle);
+    if (wait_start && ret == 0 && ctx->spin_cur_us == 0 && monitor_get_time_us() - wait_start < g_config.spin_us)
+        ctx->spin_cur_us = 1;
+    return ret;
+}
+
+// linked 模式: 提交一条链 = [补发 send] + (learning ? 一次学习 read : link_depth 对 read→send)
+static int link_arm(WorkerContext *ctx, LinkConn *conn) {
+    unsigned start = conn->lead_len ? 0 : 1;
+    unsigned len = (conn->lead_len ? 1 : 0) + (conn->learning ? 1 : 2 * g_config.link_depth);
+    if (sq_reserve(ctx, len) < 0)
+        return -ENOMEM;
+
+    for (unsigned i = start; i < start + len; i++) {
+        struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+        if (i & 1) {
+            io_uring_prep_read(sqe, conn->fd, conn->buffer, conn->learning ? g_config.buf_size : conn->msg_len, 0);
+        } else {
+            io_uring_prep_send(sqe, conn->fd, conn->buffer, i == 0 ? conn->lead_len : conn->msg_len, MSG_WAITALL);
+        }
+        sqe_set_conn_file(sqe);
+        if (i != start + len - 1)
+            sqe->flags |= IOSQE_IO_LINK | IOSQE_CQE_SKIP_SUCCESS;
+        io_uring_sqe_set_data(sqe, &conn->ops[i]);
+    }
+    conn->chain_start = start;
+    ctx->stats.link_chains++;
+    return 0;
+}
+
+// splice 模式: 提交一条链 = [pipe→socket 写回 pending 字节] → POLL_ADD → socket→pipe
+// fixed file 模式下 socket 在 splice 中的位置不同: 作为输出时用 IOSQE_FIXED_FILE，作为输入时用 SPLICE_F_FD_IN_FIXED
+static int splice_arm(WorkerContext *ctx, SpliceConn *conn) {
+    unsigned start = conn->pending ? SPLICE_OP_OUT : SPLICE_OP_POLL;
+    if (sq_reserve(ctx, SPLICE_OPS - start) < 0)
+        return -ENOMEM;
+
+    for (unsigned i = start; i < SPLICE_OPS; i++) {
+        struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+        if (i == SPLICE_OP_OUT) {
+            io_uring_prep_splice(sqe, conn->pipe_fds[0], -1, conn->fd, -1, conn->pending, SPLICE_F_MOVE);
+            sqe_set_conn_file(sqe);
+        } else if (i == SPLICE_OP_POLL) {
+            io_uring_prep_poll_add(sqe, conn->fd, POLLIN);
+            sqe_set_conn_file(sqe);
+        } else {
+            unsigned flags = SPLICE_F_MOVE | (g_config.fixed_files ? SPLICE_F_FD_IN_FIXED : 0);
+            io_uring_prep_splice(sqe, conn->fd, -1, conn->pipe_fds[1], -1, g_config.buf_size, flags);
+        }
+        if (i != SPLICE_OPS - 1)
+            sqe->flags |= IOSQE_IO_LINK | IOSQE_CQE_SKIP_SUCCESS;
+        io_uring_sqe_set_data(sqe, &conn->ops[i]);
+    }
+    conn->chain_start = start;
+    return 0;
+}
+
+// ==========================================
+// 写合并 (--coalesce)
+// ==========================================
+
+// 新连接: 回显已在用户态按批合并，Nagle 只会让下一批等对端 (可能被延迟的) ACK，一律关闭。
+// fixed file 模式下没有普通 fd，不设置；Unix 域 socket 没有 TCP 选项 (EOPNOTSUPP)
+static void coalesce_accept(WorkerContext *ctx, int fd) {
+    if (!g_config.coalesce || g_config.fixed_files)
+        return;
+    int one = 1;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)) < 0 && errno != EOPNOTSUPP)
+        ctx->stats.sockopt_failed++;
+}
+
+// 把连接挂到 flush 链表，本批 CQE 处理完后由 coalesce_flush 提交写
+static void coalesce_defer(WorkerContext *ctx, CoalesceNode *co) {
+    if (co->queued)
+        return;
+    co->queued = 1;
+    co->next = ctx->flush_head;
+    ctx->flush_head = co;
+}
+
+// 提交写时记录本次合并的消息数，EWMA 越过阈值 (带回差) 时切换状态: 流水线状态关闭 quickack，对端请求的 ACK
+// 推迟到合并后的回显上捎带，省去纯 ACK 包；回到交互式时恢复 quickack。内核会在空闲等情况下自行改变 ACK 模式，
+// 这里只在状态切换时设置一次，不在每次读写时付出系统调用
+static void coalesce_observe(WorkerContext *ctx, CoalesceNode *co, int fd, unsigned msgs) {
+    co->rate += ((int)(msgs << COALESCE_RATE_SHIFT) - co->rate) / 8;
+    int batched = co->rate >= (co->batched ? COALESCE_BATCHED_OFF : COALESCE_BATCHED_ON);
+    if (batched == co->batched)
+        return;
+    co->batched = batched;
+    ctx->stats.coalesce_switches++;
+    ctx->stats.coalesce_batched += batched ? 1 : -1;
+    if (g_config.fixed_files)
+        return;
+    int quickack = !batched;
+    if (setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &quickack, sizeof(quickack)) < 0 && errno != EOPNOTSUPP)
+        ctx->stats.sockopt_failed++;
+}
+
+// 连接释放
+static inline void coalesce_release(WorkerContext *ctx, CoalesceNode *co) {
+    if (co->batched)
+        ctx->stats.coalesce_batched--;
+}
+
+// pipelined 模式: 有空槽位且没有 read 在途时，把下一个空槽位交给 read
+static int pipeline_post_read(WorkerContext *ctx, PipelineConn *conn) {
+    if (conn->reading || conn->closing || conn->filled == g_config.pipeline_depth)
+        return 0;
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return -ENOMEM;
+
+    unsigned slot = (conn->head + conn->filled) % g_config.pipeline_depth;
+    io_uring_prep_read(sqe, conn->fd, conn->iov[slot].iov_base, g_config.buf_size, 0);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, &conn->ops[PIPELINE_OP_READ]);
+    conn->reading = 1;
+    return 0;
+}
+
+// pipelined 模式: 没有 writev 在途时，把排队的全部槽位 (首个槽位跳过已写出的部分) 合并为一次 writev
+static int pipeline_post_write(WorkerContext *ctx, PipelineConn *conn) {
+    if (conn->writing || conn->filled == 0)
+        return 0;
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return -ENOMEM;
+
+    unsigned depth = g_config.pipeline_depth;
+    struct iovec *vec = &conn->iov[depth];
+    for (unsigned i = 0; i < conn->filled; i++)
+        vec[i] = conn->iov[(conn->head + i) % depth];
+    vec[0].iov_base = (char *)vec[0].iov_base + conn->head_off;
+    vec[0].iov_len -= conn->head_off;
+
+    io_uring_prep_writev(sqe, conn->fd, vec, conn->filled, 0);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, &conn->ops[PIPELINE_OP_WRITE]);
+    conn->writing = 1;
+    ctx->stats.pipeline_writes++;
+    ctx->stats.pipeline_iovecs += conn->filled;
+    if (g_config.coalesce)
+        coalesce_observe(ctx, &conn->co, conn->fd, conn->filled);
+    return 0;
+}
+
+// 连接出错但仍有 read/write 在途时 shutdown socket，让在途请求尽快完成，之后才能释放上下文
+static void conn_shutdown(WorkerContext *ctx, int fd) {
+    if (!g_config.fixed_files) {
+        shutdown(fd, SHUT_RDWR);
+        return;
+    }
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return;
+    io_uring_prep_shutdown(sqe, fd, SHUT_RDWR);
+    sqe_set_conn_file(sqe);
+    sqe->flags |= IOSQE_CQE_SKIP_SUCCESS;
+    io_uring_sqe_set_data(sqe, &ctx->close_ctx);
+}
+
+// pipelined 模式出错: 丢弃排队数据
+static void pipeline_abort(WorkerContext *ctx, PipelineConn *conn) {
+    int first = conn->closing != 2;
+    conn->closing = 2;
+    conn->filled = 0;
+    if (first && (conn->reading || conn->writing))
+        conn_shutdown(ctx, conn->fd);
+}
+
+// stream 模式: 未回显数据低于 max_msg 且没有 read 在途时，读入 tail 块的剩余空间 (tail 已满则先追加新块)
+static int stream_post_read(WorkerContext *ctx, StreamConn *conn) {
+    if (conn->reading || conn->closing || conn->queued >= g_config.max_msg)
+        return 0;
+
+    StreamChunk *chunk = conn->tail;
+    if (chunk && chunk == conn->head && conn->head_off == chunk->len) {
+        // 唯一的块已全部写出，从头复用，小消息始终只占一个块
+        chunk->len = 0;
+        conn->head_off = 0;
+    }
+    if (!chunk || chunk->len == g_config.buf_size) {
+        chunk = slab_alloc(&ctx->chunk_pool);
+        if (!chunk)
+            return -ENOMEM;
+        chunk->next = NULL;
+        chunk->len = 0;
+        if (conn->tail)
+            conn->tail->next = chunk;
+        else
+            conn->head = chunk;
+        conn->tail = chunk;
+    }
+
+    // 新块已挂到链表上，即使这里失败也会在连接关闭时释放
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return -ENOMEM;
+
+    unsigned len = g_config.buf_size - chunk->len;
+    if (len > g_config.max_msg - conn->queued)
+        len = g_config.max_msg - conn->queued;
+    io_uring_prep_read(sqe, conn->fd, chunk->data + chunk->len, len, 0);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, &conn->ops[PIPELINE_OP_READ]);
+    conn->reading = 1;
+    return 0;
+}
+
+// stream 模式: 没有 writev 在途时，从 head 块的断点开始，一次写出最多 STREAM_MAX_IOV 个块
+static int stream_post_write(WorkerContext *ctx, StreamConn *conn) {
+    if (conn->writing || conn->queued == 0)
+        return 0;
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return -ENOMEM;
+
+    unsigned n = 0;
+    conn->write_len = 0;
+    for (StreamChunk *chunk = conn->head; chunk && n < STREAM_MAX_IOV; chunk = chunk->next) {
+        unsigned off = chunk == conn->head ? conn->head_off : 0;
+        conn->vec[n].iov_base = chunk->data + off;
+        conn->vec[n].iov_len = chunk->len - off;
+        conn->write_len += chunk->len - off;
+        n++;
+    }
+
+    io_uring_prep_writev(sqe, conn->fd, conn->vec, n, 0);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, &conn->ops[PIPELINE_OP_WRITE]);
+    conn->writing = 1;
+    ctx->stats.stream_writes++;
+    ctx->stats.stream_iovecs += n;
+    return 0;
+}
+
+// stream 模式: 释放已写出的满块；未满的 tail 块可能仍有 read 在途，留给 stream_post_read 复用
+static void stream_consume(WorkerContext *ctx, StreamConn *conn, unsigned bytes) {
+    conn->queued -= bytes;
+    while (bytes > 0) {
+        StreamChunk *chunk = conn->head;
+        unsigned avail = chunk->len - conn->head_off;
+        if (bytes < avail) {
+            conn->head_off += bytes;
+            return;
+        }
+        bytes -= avail;
+        conn->head_off += avail;
+        if (chunk->len < g_config.buf_size)
+            return;
+        conn->head = chunk->next;
+        if (!conn->head)
+            conn->tail = NULL;
+        conn->head_off = 0;
+        slab_free(&ctx->chunk_pool, chunk);
+    }
+}
+
+// stream 模式: 释放连接的全部数据块和上下文
+static void stream_release(WorkerContext *ctx, StreamConn *conn) {
+    while (conn->head) {
+        StreamChunk *next = conn->head->next;
+        slab_free(&ctx->chunk_pool, conn->head);
+        conn->head = next;
+    }
+    slab_free(&ctx->conn_pool, conn);
+}
+
+// stream 模式出错: 丢弃排队数据 (块在连接关闭时统一释放)
+static void stream_abort(WorkerContext *ctx, StreamConn *conn) {
+    int first = conn->closing != 2;
+    conn->closing = 2;
+    conn->queued = 0;
+    if (first && (conn->reading || conn->writing))
+        conn_shutdown(ctx, conn->fd);
+}
+
+// framed 模式: 没有 read 在途且缓冲区尾部还有空间时，读入 [filled, buf_size)
+static int framed_post_read(WorkerContext *ctx, FramedConn *conn) {
+    if (conn->reading || conn->closing || conn->filled == g_config.buf_size)
+        return 0;
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return -ENOMEM;
+
+    io_uring_prep_read(sqe, conn->fd, conn->buffer + conn->filled, g_config.buf_size - conn->filled, 0);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, &conn->ops[PIPELINE_OP_READ]);
+    conn->reading = 1;
+    return 0;
+}
+
+// framed 模式: 没有 write 在途时，把排队的全部完整帧 [out_off, parsed) 合并为一次 write
+static int framed_post_write(WorkerContext *ctx, FramedConn *conn) {
+    if (conn->writing || conn->out_off == conn->parsed)
+        return 0;
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return -ENOMEM;
+
+    conn->write_len = conn->parsed - conn->out_off;
+    if (g_config.coalesce && conn->next_size) {
+        // 还有未收齐的帧，它的回显随后就到: 让内核先留住这次写的尾段，与下一次写合并成段
+        io_uring_prep_send(sqe, conn->fd, conn->buffer + conn->out_off, conn->write_len, MSG_MORE);
+        ctx->stats.coalesce_msg_more++;
+    } else {
+        io_uring_prep_write(sqe, conn->fd, conn->buffer + conn->out_off, conn->write_len, 0);
+    }
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, &conn->ops[PIPELINE_OP_WRITE]);
+    conn->writing = 1;
+    ctx->stats.framed_writes++;
+    if (g_config.coalesce && conn->frames)
+        coalesce_observe(ctx, &conn->co, conn->fd, conn->frames);
+    conn->frames = 0;
+    return 0;
+}
+
+// framed 模式: 完整帧都已写出且读写都不在途时整理缓冲区。没有剩余数据时直接从头复用；
+// 尾部放不下未收齐的帧时把已收到的部分搬到开头，这是唯一的拷贝，且只涉及一个不完整的帧
+static void framed_compact(WorkerContext *ctx, FramedConn *conn) {
+    if (conn->reading || conn->writing || conn->out_off != conn->parsed || conn->parsed == 0)
+        return;
+    unsigned rest = conn->filled - conn->parsed;
+    if (rest > 0) {
+        if (conn->parsed + conn->next_size <= g_config.buf_size)
+            return;
+        memmove(conn->buffer, conn->buffer + conn->parsed, rest);
+        ctx->stats.framed_compacts++;
+        ctx->stats.framed_compact_bytes += rest;
+    }
+    conn->out_off = 0;
+    conn->parsed = 0;
+    conn->filled = rest;
+}
+
+// framed 模式出错: 丢弃排队的帧
+static void framed_abort(WorkerContext *ctx, FramedConn *conn) {
+    int first = conn->closing != 2;
+    conn->closing = 2;
+    conn->out_off = conn->parsed;
+    conn->frames = 0;
+    if (first && (conn->reading || conn->writing))
+        conn_shutdown(ctx, conn->fd);
+}
+
+// sparse 模式: 空闲等待 POLLIN
+static void sparse_post_poll(WorkerContext *ctx, SparseConn *conn) {
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return;
+    io_uring_prep_poll_add(sqe, conn->hdr.fd, POLLIN);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, conn);
+    conn->state = SPARSE_POLL;
+    conn_timer_arm(ctx, &conn->timer, 0);
+}
+
+// sparse 模式: 非阻塞读，socket 已无数据时返回 -EAGAIN 而不是占着 buffer 等待
+static void sparse_post_recv(WorkerContext *ctx, SparseConn *conn) {
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return;
+    io_uring_prep_recv(sqe, conn->hdr.fd, conn->buf, g_config.buf_size, MSG_DONTWAIT);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, conn);
+    conn->state = SPARSE_RECV;
+}
+
+static void sparse_post_send(WorkerContext *ctx, SparseConn *conn) {
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return;
+    io_uring_prep_send(sqe, conn->hdr.fd, conn->buf + conn->off, conn->len - conn->off, MSG_WAITALL);
+    sqe_set_conn_file(sqe);
+    io_uring_sqe_set_data(sqe, conn);
+    conn->state = SPARSE_SEND;
+    conn_timer_arm(ctx, &conn->timer, 1);
+}
+
+// 当前回显模式下每连接上下文的大小，决定对象池的对象大小
+static size_t conn_obj_size() {
+    if (g_config.backend == BACKEND_EPOLL)
+        return sizeof(EpollConn) + g_config.buf_size;
+    switch (g_config.echo_mode) {
+    case ECHO_MULTISHOT:
+        return sizeof(RecvConn);
+    case ECHO_LINKED:
+        return sizeof(LinkConn) + (1 + 2 * g_config.link_depth) * sizeof(LinkOp) + g_config.buf_size;
+    case ECHO_SPLICE:
+        return sizeof(SpliceConn);
+    case ECHO_STREAM:
+        return sizeof(StreamConn);
+    case ECHO_SPARSE:
+        return sizeof(SparseConn);
+    case ECHO_FRAMED:
+        return sizeof(FramedConn) + g_config.buf_size;
+    case ECHO_PIPELINED:
+        return sizeof(PipelineConn) + 2 * g_config.pipeline_depth * sizeof(struct iovec) +
+               (size_t)g_config.pipeline_depth * g_config.buf_size;
+    default:
+        return sizeof(IoContext) + g_config.buf_size;
+    }
+}
+
+#ifdef ENABLE_EBPF
+// sockmap 的转发键由 TCP 四元组构成，Unix 域连接不加入，保持其作为无 eBPF 加速的本机 IPC 基线
+static void sockmap_add_conn(int fd) {
+    if (g_unix_listen_fd >= 0) {
+        int domain = 0;
+        socklen_t len = sizeof(domain);
+        if (getsockopt(fd, SOL_SOCKET, SO_DOMAIN, &domain, &len) == 0 && domain == AF_UNIX)
+            return;
+    }
+    sockmap_loader_add_socket(g_sockmap, fd);
+}
+#endif
+
+// 关闭客户端连接并更新统计
+static void close_connection(WorkerContext *ctx, int fd) {
+    if (g_config.fixed_files) {
+        add_close_direct_request(ctx, fd, &ctx->close_ctx);
+        ctx->stats.active_connections--;
+        return;
+    }
+#ifdef ENABLE_EBPF
+    if (g_sockmap)
+        sockmap_loader_remove_socket(g_sockmap, fd);
+#endif
+    close(fd);
+    ctx->stats.active_connections--;
+}
+
+// classic 模式连接出错或对端关闭: 停止计时、关闭 fd 并释放上下文
+static void classic_release(WorkerContext *ctx, IoContext *conn) {
+    conn_timer_cancel(ctx, &conn->timer);
+    close_connection(ctx, conn->hdr.fd);
+#ifdef ENABLE_TLS
+    if (conn->ssl)
+        SSL_free(conn->ssl);
+#endif
+    slab_free(&ctx->conn_pool, conn);
+}
+
+#ifdef ENABLE_TLS
+// ==========================================
+// TLS
+// ==========================================
+// 握手在事件循环中非阻塞推进，不占用 Worker: SSL_do_handshake 读写不到数据时返回 WANT_READ / WANT_WRITE，
+// io_uring 后端为此挂一个 POLL_ADD，epoll 后端等待连接注册时的边缘触发事件，就绪后再推进一步。
+// 每个握手在 Worker 的 tls_timers 上计时，TLS_HANDSHAKE_TIMEOUT_MS 内没有完成的连接被关闭，
+// 只连接不发 ClientHello 的客户端不会拖住同一 Worker 上的其他连接。
+// 完成后 kTLS 模式把密钥装入内核，回显路径与明文完全相同；user 模式换成内存 BIO，由 classic 回显路径在用户态加解密
+
+// 握手结束 (ok 为 0 表示失败或超时): 耗时记入 lat_tls，成功时 kTLS 模式装入密钥，user 模式换成内存 BIO
+// 返回 0 成功 (*user_ssl 为 user 模式的 SSL，kTLS 模式为 NULL)，-1 表示连接应被关闭；两种情况下 hs->ssl 都已清空
+static int tls_handshake_end(WorkerContext *ctx, TlsHandshake *hs, int ok, SSL **user_ssl) {
+    int fd = hs->hdr.fd;
+    SSL *ssl = hs->ssl;
+    long long elapsed_ns = monitor_get_time_ns() - hs->start_ns;
+
+    hs->ssl = NULL;
+    timer_wheel_cancel(&ctx->tls_timers, &hs->timer);
+    histogram_record(&ctx->lat_tls, elapsed_ns);
+    ctx->stats.tls_pending--;
+    *user_ssl = NULL;
+    if (!ok) {
+        SSL_free(ssl);
+        ctx->stats.tls_failed++;
+        LOG_WARN(g_logger, "[Worker %d] TLS 握手失败 (fd=%d, %.1f ms)", ctx->thread_id, fd, elapsed_ns / 1e6);
+        return -1;
+    }
+    ctx->stats.tls_handshake_us += elapsed_ns / 1000;
+
+    if (g_config.tls == TLS_MODE_USER) {
+        if (tls_session_use_memory_bio(ssl) < 0) {
+            SSL_free(ssl);
+            ctx->stats.tls_failed++;
+            return -1;
+        }
+        *user_ssl = ssl;
+        ctx->stats.tls_handshakes++;
+        return 0;
+    }
+
+    int ret = tls_session_install_ktls(ssl, fd, 1);
+    SSL_free(ssl);
+    if (ret < 0) {
+        ctx->stats.tls_failed++;
+        LOG_WARN(g_logger, "[Worker %d] kTLS 安装失败 (fd=%d): %s", ctx->thread_id, fd, strerror(-ret));
+        return -1;
+    }
+    ctx->stats.tls_handshakes++;
+    return 0;
+}
+
+// 握手超时: epoll 后端没有在途操作，直接关闭；io_uring 后端的 poll 还在途，shutdown 让它完成，
+// 下一步握手读到 EOF 失败后由正常路径回收
+static void tls_timer_expire(TimerNode *timer, void *arg) {
+    WorkerContext *ctx = (WorkerContext *)arg;
+    TlsHandshake *hs = (TlsHandshake *)((char *)timer - offsetof(TlsHandshake, timer));
+
+    ctx->stats.tls_timeouts++;
+    if (g_config.backend == BACKEND_EPOLL) {
+        EpollConn *conn = (EpollConn *)((char *)hs - offsetof(EpollConn, hs));
+        SSL *user_ssl;
+        tls_handshake_end(ctx, hs, 0, &user_ssl);
+        close_connection(ctx, conn->fd);
+        slab_free(&ctx->conn_pool, conn);
+        return;
+    }
+    conn_shutdown(ctx, hs->hdr.fd);
+}
+
+// 取出 SSL 写好的密文放入 buffer，返回字节数 (没有待发送的密文时为 0)
+static int tls_user_pull(IoContext *conn) {
+    int n = BIO_read(SSL_get_wbio(conn->ssl), conn->buffer, g_config.buf_size);
+    return n > 0 ? n : 0;
+}
+
+// user 模式读完成: buffer 中的 len 字节密文交给 SSL，解出的每条记录原样加密回写。
+// 记录不完整时继续读；一次放不进 buffer 的密文在写完成后由 tls_user_pull 接着取
+static void tls_user_read(WorkerContext *ctx, IoContext *conn, int len) {
+    SSL *ssl = conn->ssl;
+    if (BIO_write(SSL_get_rbio(ssl), conn->buffer, len) != len) {
+        classic_release(ctx, conn);
+        return;
+    }
+    for (;;) {
+        int n = SSL_read(ssl, ctx->tls_plain, g_config.buf_size);
+        if (n <= 0) {
+            // 对端 close_notify 或解密失败
+            if (SSL_get_error(ssl, n) != SSL_ERROR_WANT_READ) {
+                ERR_clear_error();
+                classic_release(ctx, conn);
+                return;
+            }
+            break;
+        }
+        ctx->stats.total_requests++;
+        // 内存 BIO 不会写满，SSL_write 总是一次写完
+        if (SSL_write(ssl, ctx->tls_plain, n) != n) {
+            classic_release(ctx, conn);
+            return;
+        }
+    }
+
+    int out = tls_user_pull(conn);
+    if (out > 0)
+        add_write_request(ctx, conn->hdr.fd, conn, 0, out, 0);
+    else
+        add_read_request(ctx, conn->hdr.fd, conn);
+}
+#endif
+
+// 连接可以开始回显 (TLS 连接在握手完成后)：按回显模式分配上下文并提交第一个读请求
+// ssl: --tls user 握手完成的 SSL，由 classic 模式的 IoContext 接管；其余情况为 NULL
+static void conn_start(WorkerContext *ctx, int client_fd, void *ssl) {
+    if (g_config.echo_mode == ECHO_MULTISHOT) {
+        // 空闲连接只占用一个 RecvConn，不持有任何数据缓冲区
+        RecvConn *conn = slab_alloc(&ctx->conn_pool);
+        if (!conn) {
+            close_connection(ctx, client_fd);
+            return;
+        }
+        memset(conn, 0, sizeof(RecvConn));
+        add_multishot_recv_request(ctx, client_fd, conn);
+    } else if (g_config.echo_mode == ECHO_LINKED) {
+        // 第一条链只有一次 buf_size 长度的 read，用来学习消息长度
+        unsigned nops = 1 + 2 * g_config.link_depth;
+        LinkConn *conn = slab_alloc(&ctx->conn_pool);
+        if (!conn) {
+            close_connection(ctx, client_fd);
+            return;
+        }
+        memset(conn, 0, sizeof(LinkConn));
+        conn->fd = client_fd;
+        conn->learning = 1;
+        conn->buffer = (char *)&conn->ops[nops];
+        for (unsigned i = 0; i < nops; i++) {
+            conn->ops[i].hdr.fd = client_fd;
+            conn->ops[i].hdr.type = EVENT_LINK;
+            conn->ops[i].idx = i;
+            conn->ops[i].conn = conn;
+        }
+        if (link_arm(ctx, conn) < 0) {
+            close_connection(ctx, client_fd);
+            slab_free(&ctx->conn_pool, conn);
+            return;
+        }
+    } else if (g_config.echo_mode == ECHO_SPLICE) {
+        SpliceConn *conn = slab_alloc(&ctx->conn_pool);
+        if (!conn) {
+            close_connection(ctx, client_fd);
+            return;
+        }
+        if (pipe_acquire(ctx, conn->pipe_fds) < 0) {
+            LOG_WARN(g_logger, "[Worker %d] 创建 pipe 失败: %s", ctx->thread_id, strerror(errno));
+            close_connection(ctx, client_fd);
+            slab_free(&ctx->conn_pool, conn);
+            return;
+        }
+        conn->fd = client_fd;
+        conn->pending = 0;
+        for (unsigned i = 0; i < SPLICE_OPS; i++) {
+            conn->ops[i].hdr.fd = client_fd;
+            conn->ops[i].hdr.type = EVENT_SPLICE;
+            conn->ops[i].idx = i;
+            conn->ops[i].conn = conn;
+        }
+        if (splice_arm(ctx, conn) < 0) {
+            close_connection(ctx, client_fd);
+            pipe_release(ctx, conn->pipe_fds, 1);
+            slab_free(&ctx->conn_pool, conn);
+            return;
+        }
+    } else if (g_config.echo_mode == ECHO_PIPELINED) {
+        unsigned depth = g_config.pipeline_depth;
+        PipelineConn *conn = slab_alloc(&ctx->conn_pool);
+        if (!conn) {
+            close_connection(ctx, client_fd);
+            return;
+        }
+        memset(conn, 0, sizeof(PipelineConn));
+        conn->fd = client_fd;
+        conn->buffer = (char *)&conn->iov[2 * depth];
+        for (unsigned i = 0; i < depth; i++)
+            conn->iov[i].iov_base = conn->buffer + (size_t)i * g_config.buf_size;
+        for (unsigned i = 0; i < PIPELINE_OPS; i++) {
+            conn->ops[i].hdr.fd = client_fd;
+            conn->ops[i].hdr.type = EVENT_PIPELINE;
+            conn->ops[i].idx = i;
+            conn->ops[i].conn = conn;
+        }
+        conn->co.op = &conn->ops[PIPELINE_OP_WRITE];
+        if (pipeline_post_read(ctx, conn) < 0) {
+            close_connection(ctx, client_fd);
+            slab_free(&ctx->conn_pool, conn);
+            return;
+        }
+    } else if (g_config.echo_mode == ECHO_SPARSE) {
+        SparseConn *conn = slab_alloc(&ctx->conn_pool);
+        if (!conn) {
+            close_connection(ctx, client_fd);
+            return;
+        }
+        conn->hdr.fd = client_fd;
+        conn->hdr.type = EVENT_SPARSE;
+        conn->buf = NULL;
+        timer_node_init(&conn->timer);
+        sparse_post_poll(ctx, conn);
+    } else if (g_config.echo_mode == ECHO_FRAMED) {
+        FramedConn *conn = slab_alloc(&ctx->conn_pool);
+        if (!conn) {
+            close_connection(ctx, client_fd);
+            return;
+        }
+        memset(conn, 0, sizeof(FramedConn));
+        conn->fd = client_fd;
+        for (unsigned i = 0; i < PIPELINE_OPS; i++) {
+            conn->ops[i].hdr.fd = client_fd;
+            conn->ops[i].hdr.type = EVENT_FRAMED;
+            conn->ops[i].idx = i;
+            conn->ops[i].conn = conn;
+        }
+        conn->co.op = &conn->ops[PIPELINE_OP_WRITE];
+        if (framed_post_read(ctx, conn) < 0) {
+            close_connection(ctx, client_fd);
+            slab_free(&ctx->conn_pool, conn);
+            return;
+        }
+    } else if (g_config.echo_mode == ECHO_STREAM) {
+        StreamConn *conn = slab_alloc(&ctx->conn_pool);
+        if (!conn) {
+            close_connection(ctx, client_fd);
+            return;
+        }
+        memset(conn, 0, sizeof(StreamConn));
+        conn->fd = client_fd;
+        for (unsigned i = 0; i < PIPELINE_OPS; i++) {
+            conn->ops[i].hdr.fd = client_fd;
+            conn->ops[i].hdr.type = EVENT_STREAM;
+            conn->ops[i].idx = i;
+            conn->ops[i].conn = conn;
+        }
+        if (stream_post_read(ctx, conn) < 0) {
+            close_connection(ctx, client_fd);
+            stream_release(ctx, conn);
+            return;
+        }
+    } else {
+        IoContext *client_ctx = slab_alloc(&ctx->conn_pool);
+        if (!client_ctx) {
+#ifdef ENABLE_TLS
+            if (ssl)
+                SSL_free(ssl);
+#endif
+            close_connection(ctx, client_fd);
+            return;
+        }
+        timer_node_init(&client_ctx->timer);
+#ifdef ENABLE_TLS
+        client_ctx->ssl = ssl;
+#else
+        (void)ssl;
+#endif
+        add_read_request(ctx, client_fd, client_ctx);
+    }
+#ifdef ENABLE_EBPF
+    if (g_sockmap)
+        sockmap_add_conn(client_fd);
+#endif
+}
+
+#ifdef ENABLE_TLS
+// io_uring 后端推进一步握手: 需要等待时挂 POLL_ADD，结束后恢复阻塞 socket 并开始回显
+static void tls_uring_step(WorkerContext *ctx, TlsHandshake *hs) {
+    int events = tls_session_handshake_step(hs->ssl);
+    if (events > 0) {
+        struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+        if (sqe) {
+            io_uring_prep_poll_add(sqe, hs->hdr.fd, events);
+            io_uring_sqe_set_data(sqe, hs);
+            return;
+        }
+        events = -1;
+    }
+
+    int fd = hs->hdr.fd;
+    // 非阻塞 socket 上 io_uring 读不到数据时直接返回 -EAGAIN 而不是等待，回显路径需要阻塞 socket
+    int ok = events == 0 && fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) & ~O_NONBLOCK) == 0;
+    SSL *user_ssl;
+    int ret = tls_handshake_end(ctx, hs, ok, &user_ssl);
+    free(hs);
+    if (ret < 0)
+        close_connection(ctx, fd);
+    else
+        conn_start(ctx, fd, user_ssl);
+}
+
+// 握手等待的 poll 完成 (超时的连接被 shutdown 后同样以就绪完成，由下一步握手判定失败)
+static void handle_tls_poll(WorkerContext *ctx, TlsHandshake *hs, int res) {
+    if (res < 0) {
+        SSL *user_ssl;
+        tls_handshake_end(ctx, hs, 0, &user_ssl);
+        close_connection(ctx, hs->hdr.fd);
+        free(hs);
+        return;
+    }
+    tls_uring_step(ctx, hs);
+}
+
+// io_uring 后端开始握手: accept 出的 socket 是阻塞的，握手期间改为非阻塞，SSL 读写不到数据时立即返回。
+// 握手对象只在建连阶段存在一个 RTT 量级，直接 malloc，不占用按回显模式定长的连接对象池
+static void tls_uring_start(WorkerContext *ctx, int fd) {
+    TlsHandshake *hs = malloc(sizeof(TlsHandshake));
+    SSL *ssl = hs ? tls_session_new(g_tls_ctx, fd, 1) : NULL;
+    if (!ssl || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK) < 0) {
+        if (ssl)
+            SSL_free(ssl);
+        free(hs);
+        ctx->stats.tls_failed++;
+        close_connection(ctx, fd);
+        return;
+    }
+    hs->hdr.fd = fd;
+    hs->hdr.type = EVENT_TLS;
+    hs->ssl = ssl;
+    hs->start_ns = monitor_get_time_ns();
+    timer_node_init(&hs->timer);
+    timer_wheel_arm(&ctx->tls_timers, &hs->timer, ctx->now_us + TLS_HANDSHAKE_TIMEOUT_MS * 1000LL);
+    ctx->stats.tls_pending++;
+    tls_uring_step(ctx, hs);
+}
+#endif
+
+// 新连接建立: TLS 连接先握手，其余直接开始回显
+static void handle_new_connection(WorkerContext *ctx, int client_fd) {
+    ctx->stats.total_connections++;
+    ctx->stats.active_connections++;
+    coalesce_accept(ctx, client_fd);
+#ifdef ENABLE_TLS
+    if (g_config.tls) {
+        tls_uring_start(ctx, client_fd);
+        return;
+    }
+#endif
+    conn_start(ctx, client_fd, NULL);
+}
+
+// 连接超时到期: io_uring 后端的连接上还有 read / send / poll 在途，shutdown 让它以 EOF 或错误完成，
+// 由正常的关闭路径回收上下文；epoll 后端没有在途操作，直接关闭
+static void conn_timer_expire(TimerNode *timer, void *arg) {
+    WorkerContext *ctx = (WorkerContext *)arg;
+    int fd, writing;
+
+    if (g_config.backend == BACKEND_EPOLL) {
+        EpollConn *conn = (EpollConn *)((char *)timer - offsetof(EpollConn, timer));
+        if (conn->out_len > 0)
+            ctx->stats.write_timeouts++;
+        else
+            ctx->stats.idle_timeouts++;
+        close_connection(ctx, conn->fd);
+        slab_free(&ctx->conn_pool, conn);
+        return;
+    }
+    if (g_config.echo_mode == ECHO_SPARSE) {
+        SparseConn *conn = (SparseConn *)((char *)timer - offsetof(SparseConn, timer));
+        fd = conn->hdr.fd;
+        writing = conn->state == SPARSE_SEND;
+    } else {
+        IoContext *conn = (IoContext *)((char *)timer - offsetof(IoContext, timer));
+        fd = conn->hdr.fd;
+        writing = conn->hdr.type == EVENT_WRITE;
+    }
+    if (writing)
+        ctx->stats.write_timeouts++;
+    else
+        ctx->stats.idle_timeouts++;
+    conn_shutdown(ctx, fd);
+}
+
+// 每轮事件循环: 先记录等待返回的时间 (本轮发起 I/O 时据此计时)，处理完本轮事件后再推进时间轮，
+// epoll 后端到期时直接释放连接，不能放在处理事件之前
+static inline void worker_timer_now(WorkerContext *ctx) {
+    if (TIMEOUTS_ENABLED() || g_config.tls)
+        ctx->now_us = monitor_get_time_us();
+    if (g_config.latency)
+        ctx->loop_ns = monitor_get_time_ns();
+}
+
+// --latency: 本轮事件处理完毕。服务时间以所在轮次的等待返回时间为准，每个请求不额外读时钟
+static inline void worker_loop_done(WorkerContext *ctx) {
+    if (g_config.latency)
+        histogram_record(&ctx->lat_loop, monitor_get_time_ns() - ctx->loop_ns);
+}
+
+static inline void worker_expire_timers(WorkerContext *ctx) {
+    if (TIMEOUTS_ENABLED() && ctx->timers.armed)
+        timer_wheel_advance(&ctx->timers, ctx->now_us, conn_timer_expire, ctx);
+#ifdef ENABLE_TLS
+    if (g_config.tls && ctx->tls_timers.armed)
+        timer_wheel_advance(&ctx->tls_timers, ctx->now_us, tls_timer_expire, ctx);
+#endif
+}
+
+// ==========================================
+// 连接迁移 (work stealing)
+// ==========================================
+// 每个 Worker 按窗口统计处理的请求数。窗口结束时，负载低于平均值 threshold% 的 Worker 在最忙的 Worker 上
+// 登记窃取请求 (steal_to)；被窃取方在某个连接回显写完、尚未发起下一次读的时刻 (连接上没有任何在途操作，
+// 也没有排队的数据) 把它经 IORING_OP_MSG_RING 移交给请求方，请求方在自己的 ring 上接着读。
+// 普通 fd 进程内共享，只需传 fd 号；fixed file 模式用 IORING_MSG_SEND_FD 把 direct descriptor 装进对方的文件表
+
+// 窗口结束: 发布本 Worker 的负载，负载明显偏低时向最忙的 Worker 登记窃取
+static void migrate_tick(WorkerContext *ctx) {
+    long long now = monitor_get_time_us();
+    if (now - ctx->window_start_us < (long long)g_config.migrate_interval_ms * 1000)
+        return;
+    long long load = ctx->stats.total_requests - ctx->window_base_reqs;
+    __atomic_store_n(&ctx->window_load, load, __ATOMIC_RELAXED);
+    ctx->window_start_us = now;
+    ctx->window_base_reqs = ctx->stats.total_requests;
+
+    long long total = 0, max_load = -1;
+    int victim = -1;
+    for (int i = 0; i < g_worker_count; i++) {
+        long long l = __atomic_load_n(&g_workers[i].window_load, __ATOMIC_RELAXED);
+        total += l;
+        if (i != ctx->thread_id && l > max_load) {
+            max_load = l;
+            victim = i;
+        }
+    }
+    if (victim < 0 || total == 0)
+        return;
+    // 以百分比比较: load * n * 100 与 total * (100 ± threshold)
+    long long n = g_worker_count;
+    if (load * n * 100 >= total * (100 - (long long)g_config.migrate_threshold) ||
+        max_load * n * 100 <= total * (100 + (long long)g_config.migrate_threshold))
+        return;
+    // 只剩一个连接的 Worker 迁走它只是把热点换个核
+    if (__atomic_load_n(&g_workers[victim].stats.active_connections, __ATOMIC_RELAXED) < 2)
+        return;
+    int expected = 0;
+    if (__atomic_compare_exchange_n(&g_workers[victim].steal_to, &expected, ctx->thread_id + 1, 0, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED))
+        ctx->stats.steal_requests++;
+}
+
+// 有窃取请求时把空闲下来的连接移交出去；返回 1 表示已提交 MSG_RING，连接不再由调用方处理
+static int migrate_connection(WorkerContext *ctx, IoContext *conn) {
+    int to = __atomic_load_n(&ctx->steal_to, __ATOMIC_RELAXED);
+    if (to == 0)
+        return 0;
+    __atomic_store_n(&ctx->steal_to, 0, __ATOMIC_RELAXED);
+    if (ctx->stats.active_connections < 2)
+        return 0;
+
+    WorkerContext *dst = &g_workers[to - 1];
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return 0;
+    // 对端 CQE 的 user_data 指向对端 Worker 的 adopt_hdr，res 为 fd (普通 fd 经 len 字段传递) 或新分配的槽位号
+    if (g_config.fixed_files)
+        io_uring_prep_msg_ring_fd_alloc(sqe, dst->ring.ring_fd, conn->hdr.fd, (__u64)(uintptr_t)&dst->adopt_hdr, 0);
+    else
+        io_uring_prep_msg_ring(sqe, dst->ring.ring_fd, conn->hdr.fd, (__u64)(uintptr_t)&dst->adopt_hdr, 0);
+    conn->hdr.type = EVENT_MIGRATE;
+    io_uring_sqe_set_data(sqe, conn);
+    // 移交期间连接上没有 I/O，不计时；失败时 add_read_request 重新计时
+    conn_timer_cancel(ctx, &conn->timer);
+    return 1;
+}
+
+// 本端移交结果: 成功后释放本端的上下文 (fixed file 模式还要关闭本 ring 的槽位)，失败则留在本 Worker 继续读
+static void handle_migrate(WorkerContext *ctx, IoContext *conn, int res) {
+    if (res < 0) {
+        ctx->stats.migrate_failed++;
+        add_read_request(ctx, conn->hdr.fd, conn);
+        return;
+    }
+    ctx->stats.migrations_out++;
+    ctx->stats.active_connections--;
+    if (g_config.fixed_files)
+        add_close_direct_request(ctx, conn->hdr.fd, &ctx->close_ctx);
+    slab_free(&ctx->conn_pool, conn);
+}
+
+// 对端移交过来的连接: 从本 Worker 的对象池分配上下文并开始读
+static void handle_adopt(WorkerContext *ctx, int fd) {
+    ctx->stats.migrations_in++;
+    ctx->stats.active_connections++;
+    IoContext *conn = slab_alloc(&ctx->conn_pool);
+    if (!conn) {
+        close_connection(ctx, fd);
+        return;
+    }
+    timer_node_init(&conn->timer);
+#ifdef ENABLE_TLS
+    conn->ssl = NULL;
+#endif
+    add_read_request(ctx, fd, conn);
+}
+
+// multishot 模式: 发出连接发送队列的队首 (剩余部分)
+static inline void recv_conn_send_head(WorkerContext *ctx, RecvConn *conn) {
+    BufContext *buf = conn->head;
+    unsigned left = buf->len - buf->off;
+    add_send_buffer_request(ctx, conn->hdr.fd, buf, buf_ring_addr(ctx, buf->bid) + buf->off, left,
+                            zc_select(ctx, left));
+}
+
+// multishot 模式: recv 已终止且发送队列已清空时关闭连接；饥饿链表上的连接由 recv_rearm_starved 处理
+static void recv_conn_settle(WorkerContext *ctx, RecvConn *conn) {
+    if (!conn->closing || conn->head || conn->starved)
+        return;
+    close_connection(ctx, conn->hdr.fd);
+    slab_free(&ctx->conn_pool, conn);
+}
+
+// multishot recv 完成：从 buffer ring 取出数据排入发送队列，队列原本为空时立即回显
+static void handle_recv(WorkerContext *ctx, RecvConn *conn, struct io_uring_cqe *cqe) {
+    int res = cqe->res;
+
+    if (res > 0 && (cqe->flags & IORING_CQE_F_BUFFER)) {
+        unsigned short bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+        BufContext *buf = &ctx->send_ctxs[bid];
+        ctx->bufs_held++;
+        ctx->stats.total_bytes_recv += res;
+        ctx->stats.total_requests++;
+        if (conn->failed) {
+            buf_ring_recycle(ctx, bid);
+        } else {
+            buf->start_ns = ctx->loop_ns;
+            buf->conn = conn;
+            buf->next = NULL;
+            buf->len = res;
+            buf->off = 0;
+            if (conn->tail) {
+                conn->tail->next = buf;
+                conn->tail = buf;
+            } else {
+                conn->head = conn->tail = buf;
+                recv_conn_send_head(ctx, conn);
+            }
+        }
+    }
+
+    if (cqe->flags & IORING_CQE_F_MORE)
+        return;
+
+    // multishot 已终止：内核主动结束时重新挂载；buffer 耗尽时等有 buffer 归还再挂载，否则新的 recv 会立刻
+    // 再次以 -ENOBUFS 结束而空转；EOF/错误时等发送队列清空后关闭连接
+    if (res == -ENOBUFS) {
+        ctx->stats.buf_ring_exhausted++;
+        conn->starved = 1;
+        conn->starved_next = NULL;
+        if (ctx->starved_tail)
+            ctx->starved_tail->starved_next = conn;
+        else
+            ctx->starved_head = conn;
+        ctx->starved_tail = conn;
+    } else if (res > 0) {
+        add_multishot_recv_request(ctx, conn->hdr.fd, conn);
+    } else {
+        conn->closing = 1;
+        recv_conn_settle(ctx, conn);
+    }
+}
+
+// multishot send 完成 (零拷贝发送在通知 CQE 到达后): 归还 buffer，发出同一连接队列中的下一个
+static void handle_send(WorkerContext *ctx, BufContext *buf, struct io_uring_cqe *cqe) {
+    RecvConn *conn = buf->conn;
+    int res = cqe->res;
+
+    // 零拷贝发送先返回发送结果 (带 F_MORE)，内核释放 buffer 后再发通知 CQE (F_NOTIF)
+    if (cqe->flags & IORING_CQE_F_MORE) {
+        buf->zc_res = res;
+        return;
+    }
+    if (cqe->flags & IORING_CQE_F_NOTIF) {
+        if (res & IORING_NOTIF_USAGE_ZC_COPIED)
+            ctx->stats.zc_copied++;
+        res = buf->zc_res;
+    }
+    if (res > 0) {
+        ctx->stats.total_bytes_sent += res;
+        buf->off += res;
+        if (buf->off < buf->len) {
+            ctx->stats.short_writes++;
+            recv_conn_send_head(ctx, conn);
+            return;
+        }
+        if (g_config.latency)
+            histogram_record(&ctx->lat_service, ctx->loop_ns - buf->start_ns);
+        conn->head = buf->next;
+        if (!conn->head)
+            conn->tail = NULL;
+        buf_ring_recycle(ctx, buf->bid);
+        if (conn->head)
+            recv_conn_send_head(ctx, conn);
+        else
+            recv_conn_settle(ctx, conn);
+        return;
+    }
+
+    // 发送失败 (对端重置等): 丢弃排队的数据；recv 仍在途时 shutdown 让它以错误结束，由接收路径关闭连接
+    for (BufContext *b = conn->head; b; b = b->next)
+        buf_ring_recycle(ctx, b->bid);
+    conn->head = conn->tail = NULL;
+    conn->failed = 1;
+    if (conn->starved)
+        conn->closing = 1;
+    else if (!conn->closing)
+        conn_shutdown(ctx, conn->hdr.fd);
+    recv_conn_settle(ctx, conn);
+}
+
+// 批次末尾: 有 buffer 归还到 ring 时，为所有饥饿连接重新挂载 multishot recv (仍抢不到 buffer 的会再次挂回链表)
+static void recv_rearm_starved(WorkerContext *ctx) {
+    if (ctx->bufs_held >= g_config.buf_ring_entries)
+        return;
+    RecvConn *conn = ctx->starved_head;
+    ctx->starved_head = ctx->starved_tail = NULL;
+    while (conn) {
+        RecvConn *next = conn->starved_next;
+        conn->starved = 0;
+        if (conn->closing)
+            recv_conn_settle(ctx, conn);
+        else
+            add_multishot_recv_request(ctx, conn->hdr.fd, conn);
+        conn = next;
+    }
+}
+
+// linked 模式的 CQE: 链尾 send 完成，或链上某个 SQE 失败/短读
+// 带 CQE_SKIP_SUCCESS 的 SQE 失败时，内核也不为被取消的后续 SQE 生成 CQE，所以每条链恰好产生一个 CQE
+static void handle_link(WorkerContext *ctx, LinkOp *op, struct io_uring_cqe *cqe) {
+    LinkConn *conn = op->conn;
+    int res = cqe->res;
+    int closing = 0;
+    int carry = 0;
+
+    // 该 SQE 之前的 SQE 都已成功且没有产生 CQE
+    for (unsigned i = conn->chain_start; i < op->idx; i++) {
+        if (i == 0) {
+            ctx->stats.total_bytes_sent += conn->lead_len;
+        } else if (i & 1) {
+            ctx->stats.total_bytes_recv += conn->msg_len;
+            ctx->stats.total_requests++;
+        } else {
+            ctx->stats.total_bytes_sent += conn->msg_len;
+        }
+    }
+
+    if (op->idx & 1) {
+        // 学习 read 或短读: 数据留在 buffer 中，由下一条链的链首 send 补发
+        if (res > 0) {
+            ctx->stats.total_bytes_recv += res;
+            ctx->stats.total_requests++;
+            carry = res;
+        } else {
+            closing = 1;
+        }
+    } else {
+        unsigned expected = op->idx == 0 ? conn->lead_len : conn->msg_len;
+        if (res > 0)
+            ctx->stats.total_bytes_sent += res;
+        if (res < 0 || (unsigned)res < expected)
+            closing = 1;
+    }
+
+    if (!closing) {
+        if (carry > 0) {
+            // 学习 read 的结果成为新的 msg_len；短读说明消息长度变了，补发后重新学习
+            if (conn->learning)
+                conn->msg_len = carry;
+            else
+                ctx->stats.link_breaks++;
+            conn->learning = !conn->learning;
+        }
+        conn->lead_len = carry;
+        if (link_arm(ctx, conn) == 0)
+            return;
+        LOG_WARN(g_logger, "[Worker %d] 延迟提交队列扩容失败，关闭连接", ctx->thread_id);
+    }
+    close_connection(ctx, conn->fd);
+    slab_free(&ctx->conn_pool, conn);
+}
+
+// splice 模式的 CQE: 链尾 socket→pipe 完成，或链上某个 SQE 失败
+static void handle_splice(WorkerContext *ctx, LinkOp *op, struct io_uring_cqe *cqe) {
+    SpliceConn *conn = op->conn;
+    int res = cqe->res;
+
+    // 链首的写回没有产生 CQE 说明已全部写出
+    if (conn->chain_start == SPLICE_OP_OUT && op->idx > SPLICE_OP_OUT)
+        ctx->stats.total_bytes_sent += conn->pending;
+
+    if (op->idx == SPLICE_OP_IN && (res > 0 || res == -EAGAIN)) {
+        // POLLIN 之后 socket 上的数据可能已被取走 (-EAGAIN)，此时只重新挂 poll
+        conn->pending = res > 0 ? res : 0;
+        if (res > 0) {
+            ctx->stats.total_bytes_recv += res;
+            ctx->stats.total_requests++;
+        }
+        if (splice_arm(ctx, conn) == 0)
+            return;
+        LOG_WARN(g_logger, "[Worker %d] 延迟提交队列扩容失败，关闭连接", ctx->thread_id);
+        close_connection(ctx, conn->fd);
+        pipe_release(ctx, conn->pipe_fds, 0);
+        slab_free(&ctx->conn_pool, conn);
+        return;
+    }
+
+    // EOF 或错误；写回失败时 pipe 中可能残留数据，不能放回池中
+    if (op->idx == SPLICE_OP_OUT && res > 0)
+        ctx->stats.total_bytes_sent += res;
+    close_connection(ctx, conn->fd);
+    pipe_release(ctx, conn->pipe_fds, op->idx != SPLICE_OP_OUT);
+    slab_free(&ctx->conn_pool, conn);
+}
+
+// pipelined 模式: 处理完一个 CQE 或 flush 时提交后续读写，连接已关闭且没有在途操作时释放。
+// --coalesce 时写推迟到本批 CQE 处理完 (flush 非 0) 再提交，读照常立即提交
+static void pipeline_settle(WorkerContext *ctx, PipelineConn *conn, int flush) {
+    int ret = 0;
+    if (g_config.coalesce && !flush && !conn->writing && conn->filled > 0)
+        coalesce_defer(ctx, &conn->co);
+    else
+        ret = pipeline_post_write(ctx, conn);
+    if (ret < 0 || pipeline_post_read(ctx, conn) < 0) {
+        LOG_WARN(g_logger, "[Worker %d] 延迟提交队列扩容失败，关闭连接", ctx->thread_id);
+        pipeline_abort(ctx, conn);
+    }
+    if (!conn->closing || conn->reading || conn->writing || conn->filled > 0 || conn->co.queued)
+        return;
+    coalesce_release(ctx, &conn->co);
+    close_connection(ctx, conn->fd);
+    slab_free(&ctx->conn_pool, conn);
+}
+
+// pipelined 模式的 CQE: read 或 writev 完成，两者互不等待
+static void handle_pipeline(WorkerContext *ctx, LinkOp *op, struct io_uring_cqe *cqe) {
+    PipelineConn *conn = op->conn;
+    unsigned depth = g_config.pipeline_depth;
+    int res = cqe->res;
+
+    if (op->idx == PIPELINE_OP_READ) {
+        conn->reading = 0;
+        if (res > 0 && !conn->closing) {
+            unsigned slot = (conn->head + conn->filled) % depth;
+            conn->iov[slot].iov_len = res;
+            conn->filled++;
+            ctx->stats.total_bytes_recv += res;
+            ctx->stats.total_requests++;
+            if (conn->filled == depth)
+                ctx->stats.pipeline_stalls++;
+        } else if (res == 0 && !conn->closing) {
+            conn->closing = 1;
+        } else if (res < 0) {
+            pipeline_abort(ctx, conn);
+        }
+    } else {
+        conn->writing = 0;
+        if (res > 0) {
+            // 按写出的字节数依次释放槽位，最后一个槽位可能只写出一部分
+            ctx->stats.total_bytes_sent += res;
+            unsigned left = res;
+            while (left > 0 && conn->filled > 0) {
+                unsigned avail = conn->iov[conn->head].iov_len - conn->head_off;
+                if (left < avail) {
+                    conn->head_off += left;
+                    break;
+                }
+                left -= avail;
+                conn->head_off = 0;
+                conn->head = (conn->head + 1) % depth;
+                conn->filled--;
+            }
+        } else {
+            pipeline_abort(ctx, conn);
+        }
+    }
+
+    pipeline_settle(ctx, conn, 0);
+}
+
+// stream 模式的 CQE: read 追加到 tail 块，writev 按写出字节数推进输出队列，短写时剩余部分随下一次 writev 重新提交
+static void handle_stream(WorkerContext *ctx, LinkOp *op, struct io_uring_cqe *cqe) {
+    StreamConn *conn = op->conn;
+    int res = cqe->res;
+
+    if (op->idx == PIPELINE_OP_READ) {
+        conn->reading = 0;
+        if (res > 0 && !conn->closing) {
+            conn->tail->len += res;
+            conn->queued += res;
+            ctx->stats.total_bytes_recv += res;
+            ctx->stats.total_requests++;
+            if (conn->queued >= g_config.max_msg)
+                ctx->stats.stream_stalls++;
+        } else if (res == 0 && !conn->closing) {
+            conn->closing = 1;
+        } else if (res < 0) {
+            stream_abort(ctx, conn);
+        }
+    } else {
+        conn->writing = 0;
+        if (res > 0 && conn->closing != 2) {
+            ctx->stats.total_bytes_sent += res;
+            if ((unsigned)res < conn->write_len)
+                ctx->stats.short_writes++;
+            stream_consume(ctx, conn, res);
+        } else if (res <= 0) {
+            stream_abort(ctx, conn);
+        }
+    }
+
+    if (stream_post_write(ctx, conn) < 0 || stream_post_read(ctx, conn) < 0) {
+        LOG_WARN(g_logger, "[Worker %d] 延迟提交队列或块池分配失败，关闭连接", ctx->thread_id);
+        stream_abort(ctx, conn);
+    }
+    if (!conn->closing || conn->reading || conn->writing || conn->queued > 0)
+        return;
+    close_connection(ctx, conn->fd);
+    stream_release(ctx, conn);
+}
+
+// framed 模式: 同 pipeline_settle，提交前先整理缓冲区
+static void framed_settle(WorkerContext *ctx, FramedConn *conn, int flush) {
+    int ret = 0;
+    framed_compact(ctx, conn);
+    if (g_config.coalesce && !flush && !conn->writing && conn->out_off < conn->parsed)
+        coalesce_defer(ctx, &conn->co);
+    else
+        ret = framed_post_write(ctx, conn);
+    if (ret < 0 || framed_post_read(ctx, conn) < 0) {
+        LOG_WARN(g_logger, "[Worker %d] 延迟提交队列扩容失败，关闭连接", ctx->thread_id);
+        framed_abort(ctx, conn);
+    }
+    if (!conn->closing || conn->reading || conn->writing || conn->out_off < conn->parsed || conn->co.queued)
+        return;
+    coalesce_release(ctx, &conn->co);
+    close_connection(ctx, conn->fd);
+    slab_free(&ctx->conn_pool, conn);
+}
+
+// framed 模式的 CQE: read 完成后从 parsed 开始切分出完整帧，write 按写出字节数推进 out_off，短写时剩余部分随
+// 下一次 write 重新提交。未收齐的帧长度没变时不重复扫描帧头
+static void handle_framed(WorkerContext *ctx, LinkOp *op, struct io_uring_cqe *cqe) {
+    FramedConn *conn = op->conn;
+    int res = cqe->res;
+
+    if (op->idx == PIPELINE_OP_READ) {
+        conn->reading = 0;
+        if (res > 0 && !conn->closing) {
+            conn->filled += res;
+            ctx->stats.total_bytes_recv += res;
+            unsigned avail = conn->filled - conn->parsed;
+            FrameScan scan;
+            if (avail < conn->next_size) {
+                // 未收齐的帧还差数据，不必重新扫描
+            } else if (frame_scan(conn->buffer + conn->parsed, avail, g_config.buf_size, &scan) < 0) {
+                ctx->stats.framed_errors++;
+                LOG_WARN(g_logger, "[Worker %d] 帧长超过缓冲区 %u 字节 (-S)，关闭连接", ctx->thread_id,
+                         g_config.buf_size);
+                framed_abort(ctx, conn);
+            } else {
+                conn->parsed += scan.bytes;
+                conn->next_size = scan.next_size;
+                conn->frames += scan.frames;
+                ctx->stats.total_requests += scan.frames;
+                if (scan.frames)
+                    ctx->stats.framed_delay_us += monitor_get_time_us() * scan.frames - scan.sent_us;
+            }
+        } else if (res == 0 && !conn->closing) {
+            conn->closing = 1;
+        } else if (res < 0) {
+            framed_abort(ctx, conn);
+        }
+    } else {
+        conn->writing = 0;
+        if (res > 0 && conn->closing != 2) {
+            ctx->stats.total_bytes_sent += res;
+            if ((unsigned)res < conn->write_len)
+                ctx->stats.short_writes++;
+            conn->out_off += res;
+        } else if (res <= 0) {
+            framed_abort(ctx, conn);
+        }
+    }
+
+    framed_settle(ctx, conn, 0);
+}
+
+// 本批 CQE 处理完: 为 flush 链表上的每个连接提交一次合并后的写
+static void coalesce_flush(WorkerContext *ctx) {
+    CoalesceNode *co = ctx->flush_head;
+    ctx->flush_head = NULL;
+    while (co) {
+        CoalesceNode *next = co->next;
+        co->queued = 0;
+        ctx->stats.coalesce_flushes++;
+        if (co->op->hdr.type == EVENT_PIPELINE)
+            pipeline_settle(ctx, co->op->conn, 1);
+        else
+            framed_settle(ctx, co->op->conn, 1);
+        co = next;
+    }
+}
+
+// sparse 模式的 CQE: poll → recv → send → recv ... → (-EAGAIN) 归还 buffer → poll
+static void handle_sparse(WorkerContext *ctx, SparseConn *conn, struct io_uring_cqe *cqe) {
+    int res = cqe->res;
+
+    switch (conn->state) {
+    case SPARSE_POLL:
+        if (res < 0 || !(res & POLLIN))
+            goto close_conn;
+        conn->buf = slab_alloc(&ctx->chunk_pool);
+        if (!conn->buf)
+            goto close_conn;
+        sparse_post_recv(ctx, conn);
+        return;
+    case SPARSE_RECV:
+        if (res == -EAGAIN) {
+            // 连接重新变为空闲，buffer 立即还给其他连接使用
+            slab_free(&ctx->chunk_pool, conn->buf);
+            conn->buf = NULL;
+            sparse_post_poll(ctx, conn);
+            return;
+        }
+        if (res <= 0)
+            goto close_conn;
+        ctx->stats.total_bytes_recv += res;
+        ctx->stats.total_requests++;
+        conn->off = 0;
+        conn->len = res;
+        sparse_post_send(ctx, conn);
+        return;
+    case SPARSE_SEND:
+        if (res <= 0)
+            goto close_conn;
+        ctx->stats.total_bytes_sent += res;
+        conn->off += res;
+        if (conn->off < conn->len) {
+            ctx->stats.short_writes++;
+            sparse_post_send(ctx, conn);
+            return;
+        }
+        // 活跃连接通常紧接着还有数据，先直接再读一次，避免每个请求都多一轮 poll
+        sparse_post_recv(ctx, conn);
+        return;
+    }
+
+close_conn:
+    conn_timer_cancel(ctx, &conn->timer);
+    if (conn->buf)
+        slab_free(&ctx->chunk_pool, conn->buf);
+    close_connection(ctx, conn->hdr.fd);
+    slab_free(&ctx->conn_pool, conn);
+}
+
+// ==========================================
+// UDP 回显
+// ==========================================
+
+// 创建本 Worker 的 UDP socket 与批量收发所需的缓冲区
+static int udp_open(WorkerContext *ctx) {
+    int fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+        return -1;
+    if (set_reuseport(fd) < 0)
+        goto fail;
+    if (g_config.rcvbuf && setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &g_config.rcvbuf, sizeof(g_config.rcvbuf)) < 0)
+        goto fail;
+    if (g_config.sndbuf && setsockopt(fd, SOL_SOCKET, SO_SNDBUF, &g_config.sndbuf, sizeof(g_config.sndbuf)) < 0)
+        goto fail;
+    int gro = g_config.udp_gro;
+    if (gro && setsockopt(fd, SOL_UDP, UDP_GRO, &gro, sizeof(gro)) < 0) {
+        LOG_WARN(g_logger, "[Worker %d] 设置 UDP_GRO 失败 (需要 Linux >= 5.0): %s", ctx->thread_id, strerror(errno));
+        gro = 0;
+    }
+
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(PORT);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0)
+        goto fail;
+
+    UdpState *u = calloc(1, sizeof(UdpState));
+    if (!u)
+        goto fail;
+    u->fd = fd;
+    u->slot_size = gro ? UDP_GRO_BUF_SIZE : g_config.buf_size;
+    u->buffers = malloc(UDP_BATCH * u->slot_size);
+    if (!u->buffers) {
+        free(u);
+        goto fail;
+    }
+    for (int i = 0; i < UDP_BATCH; i++) {
+        u->rx_iov[i].iov_base = u->buffers + i * u->slot_size;
+        u->rx_iov[i].iov_len = u->slot_size;
+        u->rx[i].msg_hdr.msg_iov = &u->rx_iov[i];
+        u->rx[i].msg_hdr.msg_iovlen = 1;
+        u->rx[i].msg_hdr.msg_name = &u->addrs[i];
+        u->rx[i].msg_hdr.msg_control = gro ? u->rx_ctrl[i] : NULL;
+    }
+    ctx->udp = u;
+    ctx->udp_hdr.fd = fd;
+    ctx->udp_hdr.type = EVENT_UDP;
+    return 0;
+
+fail:
+    close(fd);
+    return -1;
+}
+
+static void udp_close(WorkerContext *ctx) {
+    if (!ctx->udp)
+        return;
+    close(ctx->udp->fd);
+    free(ctx->udp->buffers);
+    free(ctx->udp);
+    ctx->udp = NULL;
+}
+
+// GRO 合并交付的消息由 cmsg 给出段长，未合并的消息段长即消息长度
+static unsigned udp_gro_size(struct msghdr *hdr, unsigned len) {
+    if (!hdr->msg_control)
+        return len;
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(hdr); cm; cm = CMSG_NXTHDR(hdr, cm)) {
+        if (cm->cmsg_level == SOL_UDP && cm->cmsg_type == UDP_GRO) {
+            int seg;
+            memcpy(&seg, CMSG_DATA(cm), sizeof(seg));
+            return seg;
+        }
+    }
+    return len;
+}
+
+// socket 可读: 一直收到 -EAGAIN (epoll 边缘触发与 multishot poll 都只在新数据到达时再次通知)
+static void udp_echo(WorkerContext *ctx) {
+    UdpState *u = ctx->udp;
+    for (;;) {
+        for (int i = 0; i < UDP_BATCH; i++) {
+            u->rx[i].msg_hdr.msg_namelen = sizeof(u->addrs[i]);
+            u->rx[i].msg_hdr.msg_controllen = u->rx[i].msg_hdr.msg_control ? sizeof(u->rx_ctrl[i]) : 0;
+        }
+        int n = recvmmsg(u->fd, u->rx, UDP_BATCH, MSG_DONTWAIT, NULL);
+        if (n < 0 && errno == EINTR)
+            continue;
+        if (n <= 0)
+            return;
+        ctx->stats.udp_batches++;
+
+        // 组装发送消息: 每条接收消息的数据原地发回，开启 GSO 时可以追加到上一条发送消息中
+        int m = 0, iov = 0, first = 0;
+        unsigned seg_size = 0;
+        size_t bytes = 0;
+        for (int i = 0; i < n; i++) {
+            struct msghdr *hdr = &u->rx[i].msg_hdr;
+            unsigned len = u->rx[i].msg_len;
+            unsigned seg = udp_gro_size(hdr, len);
+            unsigned segs = seg && len > seg ? (len + seg - 1) / seg : 1;
+            if (hdr->msg_flags & MSG_TRUNC) {
+                ctx->stats.udp_dropped += segs;
+                continue;
+            }
+            ctx->stats.udp_rx += segs;
+            ctx->stats.udp_rx_bytes += len;
+            if (segs > 1)
+                ctx->stats.udp_gro_msgs++;
+
+            // 合并条件: 同一对端、同样段长，上一条的最后一段是满的 (只有最后一段可以短)，且不超过 GSO 上限
+            int merge = g_config.udp_gso && m > 0 && seg > 0 && seg == seg_size && bytes % seg == 0 &&
+                        bytes + len <= UDP_GSO_MAX_BYTES && u->tx_segs[m - 1] + segs <= UDP_GSO_MAX_SEGS &&
+                        hdr->msg_namelen == u->rx[first].msg_hdr.msg_namelen &&
+                        memcmp(&u->addrs[i], &u->addrs[first], hdr->msg_namelen) == 0;
+            if (!merge) {
+                struct msghdr *out = &u->tx[m].msg_hdr;
+                out->msg_name = &u->addrs[i];
+                out->msg_namelen = hdr->msg_namelen;
+                out->msg_iov = &u->tx_iov[iov];
+                out->msg_iovlen = 0;
+                out->msg_control = NULL;
+                out->msg_controllen = 0;
+                u->tx_segs[m++] = 0;
+                first = i;
+                seg_size = seg;
+                bytes = 0;
+            }
+            struct msghdr *out = &u->tx[m - 1].msg_hdr;
+            u->tx_iov[iov].iov_base = u->rx_iov[i].iov_base;
+            u->tx_iov[iov++].iov_len = len;
+            out->msg_iovlen++;
+            bytes += len;
+            u->tx_segs[m - 1] += segs;
+            if (u->tx_segs[m - 1] > 1 && !out->msg_control) {
+                struct cmsghdr *cm = (struct cmsghdr *)u->tx_ctrl[m - 1];
+                uint16_t gso_size = seg;
+                cm->cmsg_level = SOL_UDP;
+                cm->cmsg_type = UDP_SEGMENT;
+                cm->cmsg_len = CMSG_LEN(sizeof(gso_size));
+                memcpy(CMSG_DATA(cm), &gso_size, sizeof(gso_size));
+                out->msg_control = cm;
+                out->msg_controllen = CMSG_SPACE(sizeof(gso_size));
+            }
+        }
+
+        // 发送缓冲区满时丢弃剩余消息 (UDP 语义)；单条消息出错只丢弃该条
+        int sent = 0;
+        while (sent < m) {
+            int r = sendmmsg(u->fd, u->tx + sent, m - sent, MSG_DONTWAIT);
+            if (r < 0) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                ctx->stats.udp_dropped += u->tx_segs[sent++];
+                continue;
+            }
+            for (int i = sent; i < sent + r; i++) {
+                ctx->stats.udp_tx += u->tx_segs[i];
+                ctx->stats.udp_tx_bytes += u->tx[i].msg_len;
+                if (u->tx_segs[i] > 1)
+                    ctx->stats.udp_gso_msgs++;
+            }
+            sent += r;
+        }
+        for (int i = sent; i < m; i++)
+            ctx->stats.udp_dropped += u->tx_segs[i];
+    }
+}
+
+// io_uring 后端: UDP socket 挂 multishot poll，可读时在 Worker 线程里批量收发
+static void udp_post_poll(WorkerContext *ctx) {
+    struct io_uring_sqe *sqe = sq_get_sqe(ctx);
+    if (!sqe)
+        return;
+    io_uring_prep_poll_multishot(sqe, ctx->udp->fd, POLLIN);
+    io_uring_sqe_set_data(sqe, &ctx->udp_hdr);
+}
+
+// io_uring 后端: 初始化 ring 及各回显模式所需资源，运行事件循环直到 running 清零
+// 初始化失败时跳到 cleanup，与正常退出共用同一段释放代码；各释放函数对尚未创建的资源是空操作
+static void uring_worker_run(WorkerContext *ctx) {
+    int thread_id = ctx->thread_id;
+    int listen_fd = -1;
+    IoContext *listener_ctx = NULL;
+    IoContext *unix_listener_ctx = NULL;
+
+    // 1. 初始化 io_uring
+    struct io_uring_params params;
+    memset(&params, 0, sizeof(params));
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = CQ_DEPTH;
+    if (g_config.defer_taskrun)
+        params.flags |= IORING_SETUP_SINGLE_ISSUER | IORING_SETUP_DEFER_TASKRUN | IORING_SETUP_COOP_TASKRUN;
+    if (g_config.sqpoll) {
+        params.flags |= IORING_SETUP_SQPOLL;
+        params.sq_thread_idle = g_config.sqpoll_idle_ms;
+        if (g_config.sqpoll_cpu_count > 0) {
+            params.flags |= IORING_SETUP_SQ_AFF;
+            params.sq_thread_cpu = cpu_set_nth(&g_config.sqpoll_cpus, thread_id % g_config.sqpoll_cpu_count);
+        }
+    }
+    int ret = io_uring_queue_init_params(QUEUE_DEPTH, &ctx->ring, &params);
+    if (ret < 0) {
+        LOG_ERROR(g_logger, "[Worker %d] io_uring_queue_init 失败: %s", thread_id, strerror(-ret));
+        return;
+    }
+    // 没有 NODROP 的内核 (< 5.5) 在 CQ 满时直接丢弃 CQE，对应的连接会永远挂起
+    if (!(params.features & IORING_FEAT_NODROP))
+        LOG_WARN(g_logger, "[Worker %d] 内核不支持 IORING_FEAT_NODROP，CQ 溢出时会丢失完成事件", thread_id);
+    if (g_config.defer_taskrun) {
+        // 注册 ring fd 后 io_uring_enter 不再需要 fdget/fdput
+        if (io_uring_register_ring_fd(&ctx->ring) < 0)
+            LOG_WARN(g_logger, "[Worker %d] 注册 ring fd 失败，继续使用普通 ring fd", thread_id);
+        LOG_INFO(g_logger, "[Worker %d] DEFER_TASKRUN: 每轮至少凑齐 %u 个 CQE (最长等待 %u us)", thread_id,
+                 g_config.min_batch, g_config.batch_wait_us);
+    }
+    if (g_config.sqpoll) {
+        if (params.flags & IORING_SETUP_SQ_AFF)
+            LOG_INFO(g_logger, "[Worker %d] SQPOLL 线程绑定 CPU %u, 空闲 %u ms 后休眠", thread_id,
+                     params.sq_thread_cpu, g_config.sqpoll_idle_ms);
+        else
+            LOG_INFO(g_logger, "[Worker %d] SQPOLL 线程未绑定 CPU, 空闲 %u ms 后休眠", thread_id,
+                     g_config.sqpoll_idle_ms);
+    }
+
+    if (g_config.busy_poll_us) {
+#ifdef HAVE_URING_NAPI
+        struct io_uring_napi napi;
+        memset(&napi, 0, sizeof(napi));
+        napi.busy_poll_to = g_config.busy_poll_us;
+        napi.prefer_busy_poll = g_config.prefer_busy_poll;
+        ret = io_uring_register_napi(&ctx->ring, &napi);
+        if (ret == 0) {
+            ctx->napi = 1;
+            LOG_INFO(g_logger, "[Worker %d] NAPI busy poll: %u us%s", thread_id, g_config.busy_poll_us,
+                     g_config.prefer_busy_poll ? " (prefer)" : "");
+        } else {
+            LOG_WARN(g_logger, "[Worker %d] 注册 NAPI busy poll 失败 (需要 Linux >= 6.9): %s，仅使用 SO_BUSY_POLL",
+                     thread_id, strerror(-ret));
+        }
+#else
+        LOG_WARN(g_logger, "[Worker %d] liburing < 2.6 不支持 io_uring_register_napi，仅使用 SO_BUSY_POLL", thread_id);
+#endif
+    }
+    ctx->spin_cur_us = g_config.spin_us;
+    ctx->adopt_hdr.fd = -1;
+    ctx->adopt_hdr.type = EVENT_ADOPT;
+    ctx->window_start_us = monitor_get_time_us();
+
+    if (g_config.fixed_files) {
+        ret = io_uring_register_files_sparse(&ctx->ring, g_config.fixed_files);
+        if (ret < 0) {
+            LOG_ERROR(g_logger, "[Worker %d] 注册 fixed file 表失败: %s", thread_id, strerror(-ret));
+            goto cleanup;
+        }
+        ctx->close_ctx.fd = -1;
+        ctx->close_ctx.type = EVENT_CLOSE;
+    }
+
+    if (g_config.echo_mode == ECHO_MULTISHOT) {
+        ret = buf_ring_setup(ctx);
+        if (ret < 0) {
+            LOG_ERROR(g_logger, "[Worker %d] buffer ring 注册失败: %s", thread_id, strerror(-ret));
+            goto cleanup;
+        }
+        LOG_INFO(g_logger, "[Worker %d] buffer ring: %u x %u 字节", thread_id, g_config.buf_ring_entries,
+                 g_config.buf_size);
+    }
+
+    if (g_config.echo_mode == ECHO_SPLICE) {
+        ret = pipe_pool_setup(ctx);
+        if (ret < 0) {
+            LOG_ERROR(g_logger, "[Worker %d] 预创建 pipe 失败: %s", thread_id, strerror(-ret));
+            goto cleanup;
+        }
+        LOG_INFO(g_logger, "[Worker %d] pipe 池: %u 个", thread_id, g_config.pipe_pool);
+    }
+
+    if (g_config.echo_mode == ECHO_STREAM || g_config.echo_mode == ECHO_SPARSE) {
+        // 块池与连接对象池同样预先缺页，容量不足时回退到 malloc
+        size_t chunk_size = g_config.buf_size + (g_config.echo_mode == ECHO_STREAM ? sizeof(StreamChunk) : 0);
+        ret = slab_pool_init(&ctx->chunk_pool, chunk_size, g_config.slab_objects, g_config.slab_hugepages);
+        if (ret < 0) {
+            LOG_ERROR(g_logger, "[Worker %d] 数据块池分配失败: %s", thread_id, strerror(-ret));
+            goto cleanup;
+        }
+        LOG_INFO(g_logger, "[Worker %d] %s 数据块池: %zu x %zu 字节", thread_id, ECHO_MODE_NAMES[g_config.echo_mode],
+                 ctx->chunk_pool.capacity, ctx->chunk_pool.obj_size);
+    }
+
+#ifdef ENABLE_TLS
+    if (g_config.tls == TLS_MODE_USER) {
+        ctx->tls_plain = malloc(g_config.buf_size);
+        if (!ctx->tls_plain) {
+            LOG_ERROR(g_logger, "[Worker %d] TLS 明文缓冲区分配失败", thread_id);
+            goto cleanup;
+        }
+    }
+#endif
+
+    ctx->zc.win_start_us = monitor_get_time_us();
+    ctx->zc.win_cpu_start_ns = monitor_get_thread_cpu_ns();
+
+    // 2. 创建监听 Socket
+    listen_fd = create_listener();
+    if (listen_fd < 0) {
+        LOG_ERROR(g_logger, "[Worker %d] 创建监听 Socket 失败: %s", thread_id, strerror(errno));
+        goto cleanup;
+    }
+    worker_register_listener(ctx, listen_fd);
+    if (g_config.udp) {
+        if (udp_open(ctx) < 0)
+            LOG_ERROR(g_logger, "[Worker %d] 创建 UDP Socket 失败: %s", thread_id, strerror(errno));
+        else
+            udp_post_poll(ctx);
+    }
+
+    // 3. 提交第一个 Accept 请求 (开启 --unix 时 Unix 域监听 socket 另挂一个)
+    listener_ctx = malloc(sizeof(IoContext));
+    unix_listener_ctx = g_unix_listen_fd >= 0 ? malloc(sizeof(IoContext)) : NULL;
+    if (!listener_ctx || (g_unix_listen_fd >= 0 && !unix_listener_ctx)) {
+        LOG_ERROR(g_logger, "[Worker %d] 分配 Accept 上下文失败", thread_id);
+        goto cleanup;
+    }
+    struct sockaddr_in client_addr;
+    socklen_t client_len = sizeof(client_addr);
+    if (g_config.echo_mode == ECHO_MULTISHOT) {
+        add_multishot_accept_request(ctx, listen_fd, listener_ctx);
+        if (unix_listener_ctx)
+            add_multishot_accept_request(ctx, g_unix_listen_fd, unix_listener_ctx);
+    } else {
+        add_accept_request(ctx, listen_fd, (struct sockaddr *)&client_addr, &client_len, listener_ctx);
+        if (unix_listener_ctx)
+            add_accept_request(ctx, g_unix_listen_fd, NULL, NULL, unix_listener_ctx);
+    }
+    worker_submit(ctx);
 
-    // 5. 事件循环
+    struct io_uring_cqe *cqe;
+
+    // 4. 事件循环
+    int idle = 1;
     while (running) {
-        struct __kernel_timespec ts;
-        ts.tv_sec = 1;
-        ts.tv_nsec = 0;
+        // 上一轮 SQ 放不下的 SQE 优先提交，直到队列清空或 SQ 不再腾出空间 (如 SQPOLL 线程尚未消费)
+        while (ctx->deferred_head != ctx->deferred_tail) {
+            unsigned queued = ctx->deferred_tail - ctx->deferred_head;
+            sq_flush_deferred(ctx);
+            worker_submit(ctx);
+            if (ctx->deferred_tail - ctx->deferred_head == queued)
+                break;
+        }
 
-        int ret = io_uring_wait_cqe_timeout(&ctx->ring, &cqe, &ts);
+        ret = worker_wait(ctx, &cqe, &idle);
+        worker_timer_now(ctx);
 
         if (ret == -ETIME) {
+            worker_publish_load(ctx, 0);
+            if (g_config.migrate)
+                migrate_tick(ctx);
+            worker_expire_timers(ctx);
+            continue;
+        }
+
+        if (ret == -EBUSY) {
+            // CQ 溢出积压 (IORING_FEAT_NODROP): 内核暂不接受新提交，先收割 CQE，积压的 CQE 会回填到 CQ
+            ctx->stats.cq_overflow++;
+            if (io_uring_cq_ready(&ctx->ring) == 0)
+                continue;
+        } else if (ret < 0) {
+            if (ret == -EINTR)
+                continue;
+            LOG_ERROR(g_logger, "[Worker %d] io_uring_wait_cqe 错误: %d", thread_id, ret);
+            break;
+        }
+
+        unsigned head;
+        int count = 0;
+
+        io_uring_for_each_cqe(&ctx->ring, head, cqe) {
+            count++;
+            IoHeader *req = (IoHeader *)io_uring_cqe_get_data(cqe);
+            int res = cqe->res;
+
+            switch (req->type) {
+            case EVENT_ACCEPT: {
+                // TCP 与 Unix 域两个监听 socket 共用此分支，按 hdr.fd 区分，原样重新提交到同一个上下文
+                int unix_accept = req->fd == g_unix_listen_fd;
+                if (res >= 0) {
+                    if (unix_accept)
+                        ctx->stats.unix_connections++;
+                    handle_new_connection(ctx, res);
+                }
+                // multishot accept 只在被内核终止 (无 F_MORE) 时才需要重新提交
+                if (g_config.echo_mode == ECHO_MULTISHOT) {
+                    if (!(cqe->flags & IORING_CQE_F_MORE))
+                        add_multishot_accept_request(ctx, req->fd, (IoContext *)req);
+                } else if (unix_accept) {
+                    add_accept_request(ctx, req->fd, NULL, NULL, (IoContext *)req);
+                } else {
+                    client_len = sizeof(client_addr);
+                    add_accept_request(ctx, listen_fd, (struct sockaddr *)&client_addr, &client_len,
+                                       listener_ctx);
+                }
+                break;
+            }
+            case EVENT_READ: {
+                IoContext *req_ctx = (IoContext *)req;
+                int bytes_read = res;
+                if (bytes_read <= 0) {
+                    classic_release(ctx, req_ctx);
+                } else {
+                    ctx->stats.total_bytes_recv += bytes_read;
+                    req_ctx->read_ns = ctx->loop_ns;
+#ifdef ENABLE_TLS
+                    if (req_ctx->ssl) {
+                        tls_user_read(ctx, req_ctx, bytes_read);
+                        break;
+                    }
+#endif
+                    ctx->stats.total_requests++;
+                    add_write_request(ctx, req->fd, req_ctx, 0, bytes_read, zc_select(ctx, bytes_read));
+                }
+                break;
+            }
+            case EVENT_WRITE: {
+                IoContext *req_ctx = (IoContext *)req;
+                // 零拷贝发送先返回发送结果 (带 F_MORE)，内核释放 buffer 后再发通知 CQE (F_NOTIF)
+                // 在通知到达前 buffer 仍被网络栈引用，不能在其上发起下一次读
+                if (cqe->flags & IORING_CQE_F_MORE) {
+                    req_ctx->zc_res = res;
+                    break;
+                }
+                if (cqe->flags & IORING_CQE_F_NOTIF) {
+                    if (res & IORING_NOTIF_USAGE_ZC_COPIED)
+                        ctx->stats.zc_copied++;
+                    res = req_ctx->zc_res;
+                }
+                int bytes_written = res;
+                if (bytes_written <= 0 && bytes_written != -EAGAIN) {
+                    classic_release(ctx, req_ctx);
+                    break;
+                }
+                // 短写或 -EAGAIN: 剩余部分写完之前不能在同一块 buffer 上发起下一次读
+                size_t written = bytes_written > 0 ? bytes_written : 0;
+                ctx->stats.total_bytes_sent += written;
+                if (written < req_ctx->iov.iov_len) {
+                    size_t off = (char *)req_ctx->iov.iov_base - req_ctx->buffer + written;
+                    size_t left = req_ctx->iov.iov_len - written;
+                    ctx->stats.short_writes++;
+                    add_write_request(ctx, req->fd, req_ctx, off, left, zc_select(ctx, left));
+                    break;
+                }
+#ifdef ENABLE_TLS
+                if (req_ctx->ssl) {
+                    int out = tls_user_pull(req_ctx);
+                    if (out > 0) {
+                        add_write_request(ctx, req->fd, req_ctx, 0, out, 0);
+                        break;
+                    }
+                }
+#endif
+                if (g_config.latency)
+                    histogram_record(&ctx->lat_service, ctx->loop_ns - req_ctx->read_ns);
+                if (g_config.migrate && migrate_connection(ctx, req_ctx))
+                    break;
+                add_read_request(ctx, req->fd, req_ctx);
+                break;
+            }
+            case EVENT_MIGRATE:
+                handle_migrate(ctx, (IoContext *)req, res);
+                break;
+            case EVENT_ADOPT:
+                handle_adopt(ctx, res);
+                break;
+            case EVENT_RECV:
+                handle_recv(ctx, (RecvConn *)req, cqe);
+                break;
+            case EVENT_LINK:
+                handle_link(ctx, (LinkOp *)req, cqe);
+                break;
+            case EVENT_SPLICE:
+                handle_splice(ctx, (LinkOp *)req, cqe);
+                break;
+            case EVENT_PIPELINE:
+                handle_pipeline(ctx, (LinkOp *)req, cqe);
+                break;
+            case EVENT_STREAM:
+                handle_stream(ctx, (LinkOp *)req, cqe);
+                break;
+            case EVENT_SPARSE:
+                handle_sparse(ctx, (SparseConn *)req, cqe);
+                break;
+            case EVENT_FRAMED:
+                handle_framed(ctx, (LinkOp *)req, cqe);
+                break;
+            case EVENT_CLOSE:
+                LOG_WARN(g_logger, "[Worker %d] close_direct/shutdown 失败: %s", thread_id, strerror(-res));
+                break;
+            case EVENT_UDP:
+                if (res > 0)
+                    udp_echo(ctx);
+                else if (res != -ECANCELED)
+                    LOG_WARN(g_logger, "[Worker %d] UDP poll 失败: %s", thread_id, strerror(-res));
+                if (!(cqe->flags & IORING_CQE_F_MORE) && running)
+                    udp_post_poll(ctx);
+                break;
+            case EVENT_SEND:
+                handle_send(ctx, (BufContext *)req, cqe);
+                break;
+            case EVENT_TLS:
+#ifdef ENABLE_TLS
+                handle_tls_poll(ctx, (TlsHandshake *)req, res);
+#endif
+                break;
+            }
+        }
+
+        io_uring_cq_advance(&ctx->ring, count);
+        if (ctx->flush_head)
+            coalesce_flush(ctx);
+        if (ctx->starved_head)
+            recv_rearm_starved(ctx);
+        ctx->stats.loop_iterations++;
+        ctx->stats.cqes_processed += count;
+        worker_publish_load(ctx, count);
+        if (__atomic_load_n(ctx->ring.sq.kflags, __ATOMIC_ACQUIRE) & IORING_SQ_CQ_OVERFLOW)
+            ctx->stats.cq_overflow++;
+        sq_flush_deferred(ctx);
+        // DEFER_TASKRUN 模式下提交合并到下一轮 worker_wait 的 io_uring_enter 中
+        if (!g_config.defer_taskrun)
+            worker_submit(ctx);
+
+        worker_loop_done(ctx);
+        if (ZC_ENABLED())
+            zc_window_tick(ctx);
+        if (g_config.migrate)
+            migrate_tick(ctx);
+        worker_expire_timers(ctx);
+    }
+    // 退出前发布最后一次快照 (ring 随后被释放)
+    worker_publish_stats(ctx);
+
+cleanup:
+    free(listener_ctx);
+    free(unix_listener_ctx);
+    free(ctx->deferred);
+    if (listen_fd >= 0)
+        close(listen_fd);
+    udp_close(ctx);
+    buf_ring_destroy(ctx);
+    pipe_pool_destroy(ctx);
+    slab_pool_destroy(&ctx->chunk_pool);
+#ifdef ENABLE_TLS
+    free(ctx->tls_plain);
+#endif
+    io_uring_queue_exit(&ctx->ring);
+}
+
+// ==========================================
+// 工作线程 (Worker) - epoll 边缘触发后端
+// ==========================================
+
+// 发送连接缓冲区中剩余的数据；socket 写满 (EAGAIN) 时保留进度，等待 EPOLLOUT
+static int epoll_flush(WorkerContext *ctx, EpollConn *conn) {
+    while (conn->out_len > 0) {
+        ssize_t n = send(conn->fd, conn->buffer + conn->out_off, conn->out_len, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn->out_off += n;
+            conn->out_len -= n;
+            ctx->stats.total_bytes_sent += n;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return 0;
+        } else {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+#ifdef ENABLE_TLS
+// epoll 后端推进一步握手: SSL 只在 read/write 返回 EAGAIN 后才报告 WANT_READ/WANT_WRITE，
+// 连接注册时已同时关注 EPOLLIN | EPOLLOUT，边缘触发下不需要修改注册
+// 返回 1 表示握手刚刚完成，0 表示继续等待，-1 表示连接已关闭
+static int epoll_tls_step(WorkerContext *ctx, EpollConn *conn) {
+    int events = tls_session_handshake_step(conn->hs.ssl);
+    if (events > 0)
+        return 0;
+    SSL *user_ssl;
+    if (tls_handshake_end(ctx, &conn->hs, events == 0, &user_ssl) < 0) {
+        close_connection(ctx, conn->fd);
+        slab_free(&ctx->conn_pool, conn);
+        return -1;
+    }
+    return 1;
+}
+#endif
+
+// 连接就绪: 边缘触发下必须一直读到 EAGAIN，否则不会再收到通知
+// 上一次的数据还没写完时不再读取，由 socket 接收缓冲区形成背压
+static void epoll_handle_conn(WorkerContext *ctx, EpollConn *conn, uint32_t events) {
+#ifdef ENABLE_TLS
+    // 握手完成后接着读: 客户端紧随握手发出的数据不会再产生新的边缘事件
+    if (conn->hs.ssl && epoll_tls_step(ctx, conn) <= 0)
+        return;
+#endif
+    if (events & EPOLLERR)
+        goto close_conn;
+    if (epoll_flush(ctx, conn) < 0)
+        goto close_conn;
+
+    while (conn->out_len == 0) {
+        ssize_t n = recv(conn->fd, conn->buffer, g_config.buf_size, 0);
+        if (n > 0) {
+            ctx->stats.total_bytes_recv += n;
+            ctx->stats.total_requests++;
+            conn->out_off = 0;
+            conn->out_len = n;
+            if (epoll_flush(ctx, conn) < 0)
+                goto close_conn;
+        } else if (n < 0 && errno == EINTR) {
+            continue;
+        } else if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            conn_timer_arm(ctx, &conn->timer, 0);
+            return;
+        } else {
+            goto close_conn;
+        }
+    }
+    // 写不下的数据等待 EPOLLOUT
+    conn_timer_arm(ctx, &conn->timer, 1);
+    return;
+
+close_conn:
+    conn_timer_cancel(ctx, &conn->timer);
+    close_connection(ctx, conn->fd);
+    slab_free(&ctx->conn_pool, conn);
+}
+
+// 监听 socket 就绪: 一次取完所有待接受的连接
+static void epoll_accept(WorkerContext *ctx, int epfd, int listen_fd) {
+    for (;;) {
+        int client_fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (client_fd < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+                LOG_WARN(g_logger, "[Worker %d] accept 失败: %s", ctx->thread_id, strerror(errno));
+            return;
+        }
+        if (listen_fd == g_unix_listen_fd)
+            ctx->stats.unix_connections++;
+        ctx->stats.total_connections++;
+        ctx->stats.active_connections++;
+        coalesce_accept(ctx, client_fd);
+
+        EpollConn *conn = slab_alloc(&ctx->conn_pool);
+        if (!conn) {
+            close_connection(ctx, client_fd);
+            continue;
+        }
+        conn->fd = client_fd;
+        conn->out_off = 0;
+        conn->out_len = 0;
+        timer_node_init(&conn->timer);
+
+        // EPOLLIN 与 EPOLLOUT 一次注册，边缘触发下之后不需要 epoll_ctl(MOD)
+        struct epoll_event ev;
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLET;
+        ev.data.ptr = conn;
+        if (epoll_ctl(epfd, EPOLL_CTL_ADD, client_fd, &ev) < 0) {
+            close_connection(ctx, client_fd);
+            slab_free(&ctx->conn_pool, conn);
             continue;
         }
+#ifdef ENABLE_EBPF
+        if (g_sockmap)
+            sockmap_add_conn(client_fd);
+#endif
+#ifdef ENABLE_TLS
+        // 握手期间只计握手超时，完成后在 epoll_handle_conn 中开始计空闲超时
+        conn->hs.ssl = NULL;
+        if (g_config.tls) {
+            conn->hs.ssl = tls_session_new(g_tls_ctx, client_fd, 1);
+            if (!conn->hs.ssl) {
+                ctx->stats.tls_failed++;
+                close_connection(ctx, client_fd);
+                slab_free(&ctx->conn_pool, conn);
+                continue;
+            }
+            conn->hs.hdr.fd = client_fd;
+            conn->hs.hdr.type = EVENT_TLS;
+            conn->hs.start_ns = monitor_get_time_ns();
+            timer_node_init(&conn->hs.timer);
+            timer_wheel_arm(&ctx->tls_timers, &conn->hs.timer, ctx->now_us + TLS_HANDSHAKE_TIMEOUT_MS * 1000LL);
+            ctx->stats.tls_pending++;
+            epoll_handle_conn(ctx, conn, 0);
+            continue;
+        }
+#endif
+        conn_timer_arm(ctx, &conn->timer, 0);
+    }
+}
+
+// epoll 后端: 统计口径与 io_uring 后端一致，loop.iterations 为 epoll_wait 次数，loop.cqes 为就绪事件数
+static void epoll_worker_run(WorkerContext *ctx) {
+    int thread_id = ctx->thread_id;
+
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        LOG_ERROR(g_logger, "[Worker %d] epoll_create1 失败: %s", thread_id, strerror(errno));
+        return;
+    }
+
+    int listen_fd = create_listener();
+    if (listen_fd < 0) {
+        LOG_ERROR(g_logger, "[Worker %d] 创建监听 Socket 失败: %s", thread_id, strerror(errno));
+        close(epfd);
+        return;
+    }
+    worker_register_listener(ctx, listen_fd);
+
+    // 监听 socket 的 data.ptr 为 NULL，用来与连接区分
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = NULL;
+    epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev);
+    if (g_config.udp) {
+        if (udp_open(ctx) < 0) {
+            LOG_ERROR(g_logger, "[Worker %d] 创建 UDP Socket 失败: %s", thread_id, strerror(errno));
+        } else {
+            ev.events = EPOLLIN | EPOLLET;
+            ev.data.ptr = ctx->udp;
+            epoll_ctl(epfd, EPOLL_CTL_ADD, ctx->udp->fd, &ev);
+        }
+    }
+    // 共享的 Unix 域监听 socket: EPOLLEXCLUSIVE 让每个新连接只唤醒一个 Worker
+    if (g_unix_listen_fd >= 0) {
+        ev.events = EPOLLIN | EPOLLET | EPOLLEXCLUSIVE;
+        ev.data.ptr = &g_unix_listen_fd;
+        epoll_ctl(epfd, EPOLL_CTL_ADD, g_unix_listen_fd, &ev);
+    }
 
-        if (ret < 0) {
-            if (ret == -EINTR)
+    struct epoll_event *events = malloc(EPOLL_MAX_EVENTS * sizeof(struct epoll_event));
+    while (running) {
+        int n = epoll_wait(epfd, events, EPOLL_MAX_EVENTS, worker_idle_wait_ms(ctx));
+        worker_timer_now(ctx);
+        if (n < 0) {
+            if (errno == EINTR)
                 continue;
-            LOG_ERROR(g_logger, "[Worker %d] io_uring_wait_cqe 错误: %d", thread_id, ret);
+            LOG_ERROR(g_logger, "[Worker %d] epoll_wait 错误: %s", thread_id, strerror(errno));
             break;
         }
+        if (n == 0) {
+            worker_publish_load(ctx, 0);
+            worker_expire_timers(ctx);
+            continue;
+        }
 
-        unsigned head;
-        int count = 0;
+        for (int i = 0; i < n; i++) {
+            if (events[i].data.ptr == NULL)
+                epoll_accept(ctx, epfd, listen_fd);
+            else if (events[i].data.ptr == ctx->udp)
+                udp_echo(ctx);
+            else if (events[i].data.ptr == &g_unix_listen_fd)
+                epoll_accept(ctx, epfd, g_unix_listen_fd);
+            else
+                epoll_handle_conn(ctx, events[i].data.ptr, events[i].events);
+        }
+        ctx->stats.loop_iterations++;
+        ctx->stats.cqes_processed += n;
+        worker_loop_done(ctx);
+        worker_publish_load(ctx, n);
+        worker_expire_timers(ctx);
+    }
+    worker_publish_stats(ctx);
 
-        io_uring_for_each_cqe(&ctx->ring, head, cqe) {
-            count++;
-            IoContext *req_ctx = (IoContext *)io_uring_cqe_get_data(cqe);
-            int res = cqe->res;
+    free(events);
+    close(listen_fd);
+    udp_close(ctx);
+    close(epfd);
+}
 
-            if (res < 0 && res != -EAGAIN) {
-                if (req_ctx->type != EVENT_ACCEPT) {
-                    close(req_ctx->fd);
-                    free(req_ctx);
-                    ctx->stats.active_connections--;
-                }
-            } else {
-                switch (req_ctx->type) {
-                case EVENT_ACCEPT: {
-                    int client_fd = res;
-                    if (client_fd >= 0) {
-                        ctx->stats.total_connections++;
-                        ctx->stats.active_connections++;
-                        IoContext *client_ctx = malloc(sizeof(IoContext));
-                        if (client_ctx) {
-                            add_read_request(&ctx->ring, client_fd, client_ctx);
+// ==========================================
+// 工作线程入口
+// ==========================================
+
+// 按 BackendType 索引的事件循环实现
+static void (*const BACKEND_RUN[])(WorkerContext *ctx) = {uring_worker_run, epoll_worker_run};
+
+void *worker_routine(void *arg) {
+    WorkerContext *ctx = (WorkerContext *)arg;
+    int thread_id = ctx->thread_id;
+
+    // 1. CPU 亲和性
+    cpu_set_t cpuset;
+    CPU_ZERO(&cpuset);
+    int cpu_id = ctx->cpu;
+    CPU_SET(cpu_id, &cpuset);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    LOG_INFO(g_logger, "[Worker %d] 绑定 CPU %d (节点 %d), 后端: %s", thread_id, cpu_id, ctx->node,
+             BACKEND_NAMES[g_config.backend]);
+    // 之后本线程的内存分配 (ring、buffer ring、对象池、数据块池) 都优先落在本节点，不依赖由谁首次触碰
+    if (g_topology.nr_nodes > 1) {
+        int err = topology_prefer_node(ctx->node);
+        if (err < 0)
+            LOG_WARN(g_logger, "[Worker %d] 设置 NUMA 内存策略失败: %s", thread_id, strerror(-err));
+    }
 #ifdef ENABLE_EBPF
-                            if (g_sockmap)
-                                sockmap_loader_add_socket(g_sockmap, client_fd);
+    if (g_reuseport)
+        reuseport_loader_set_worker_cpu(g_reuseport, thread_id, cpu_id);
 #endif
-                        } else {
-                            close(client_fd);
-                        }
-                    }
-                    client_len = sizeof(client_addr);
-                    add_accept_request(&ctx->ring, listen_fd, (struct sockaddr *)&client_addr, &client_len,
-                                       listener_ctx);
-                    break;
-                }
-                case EVENT_READ: {
-                    int bytes_read = res;
-                    if (bytes_read <= 0) {
-                        close(req_ctx->fd);
-#ifdef ENABLE_EBPF
-                        if (g_sockmap)
-                            sockmap_loader_remove_socket(g_sockmap, req_ctx->fd);
-#endif
-                        free(req_ctx);
-                        ctx->stats.active_connections--;
-                    } else {
-                        ctx->stats.total_bytes_recv += bytes_read;
-                        ctx->stats.total_requests++;
-                        add_write_request(&ctx->ring, req_ctx->fd, req_ctx, bytes_read);
-                    }
-                    break;
-                }
-                case EVENT_WRITE: {
-                    int bytes_written = res;
-                    if (bytes_written > 0) {
-                        ctx->stats.total_bytes_sent += bytes_written;
-                    }
-                    add_read_request(&ctx->ring, req_ctx->fd, req_ctx);
-                    break;
-                }
-                }
-            }
-        }
 
-        io_uring_cq_advance(&ctx->ring, count);
-        io_uring_submit(&ctx->ring);
+    // 2. 连接对象池：线程已绑核，内存在这里预先触碰，按 first-touch 落在本 Worker 所在的 NUMA 节点
+    int ret = slab_pool_init(&ctx->conn_pool, conn_obj_size(), g_config.slab_objects, g_config.slab_hugepages);
+    if (ret < 0) {
+        LOG_ERROR(g_logger, "[Worker %d] 连接对象池分配失败: %s", thread_id, strerror(-ret));
+        return NULL;
     }
+    if (g_config.slab_objects)
+        LOG_INFO(g_logger, "[Worker %d] 连接对象池: %zu x %zu 字节 (%s 页, %.1f MB)", thread_id,
+                 ctx->conn_pool.capacity, ctx->conn_pool.obj_size, slab_page_type_name(ctx->conn_pool.page_type),
+                 ctx->conn_pool.region_size / (1024.0 * 1024.0));
 
-    free(listener_ctx);
-    close(listen_fd);
-    io_uring_queue_exit(&ctx->ring);
+    // 3. 连接超时与 TLS 握手超时时间轮
+    ctx->now_us = monitor_get_time_us();
+    if (TIMEOUTS_ENABLED()) {
+        if (timer_wheel_init(&ctx->timers, TIMER_WHEEL_SLOTS, TIMER_TICK_US, ctx->now_us) < 0) {
+            LOG_ERROR(g_logger, "[Worker %d] 时间轮分配失败", thread_id);
+            slab_pool_destroy(&ctx->conn_pool);
+            return NULL;
+        }
+    }
+#ifdef ENABLE_TLS
+    // 握手超时只有一种时长，一圈覆盖得下，槽位数按它取
+    if (g_config.tls && timer_wheel_init(&ctx->tls_timers, TLS_HANDSHAKE_TIMEOUT_MS * 1000 / TIMER_TICK_US + 1,
+                                         TIMER_TICK_US, ctx->now_us) < 0) {
+        LOG_ERROR(g_logger, "[Worker %d] 时间轮分配失败", thread_id);
+        if (TIMEOUTS_ENABLED())
+            timer_wheel_destroy(&ctx->timers);
+        slab_pool_destroy(&ctx->conn_pool);
+        return NULL;
+    }
+#endif
+
+    // 4. 事件循环
+    BACKEND_RUN[g_config.backend](ctx);
+
+    if (TIMEOUTS_ENABLED())
+        timer_wheel_destroy(&ctx->timers);
+#ifdef ENABLE_TLS
+    if (g_config.tls)
+        timer_wheel_destroy(&ctx->tls_timers);
+#endif
+    slab_pool_destroy(&ctx->conn_pool);
     return NULL;
 }
 
 // ==========================================
 // 控制线程
 // ==========================================
+
+// 读取 Worker 最近一次发布的 stats 快照
+static void stats_snapshot(const WorkerContext *worker, ThreadStats *out) {
+    unsigned seq;
+    do {
+        seq = seqlock_read_begin(&worker->published.lock);
+        seqlock_copy((long long *)out, (const long long *)&worker->published.stats, STATS_WORDS);
+    } while (seqlock_read_retry(&worker->published.lock, seq));
+}
+
+// 每秒采样: 各 Worker 快照的累计值之和，相邻两个采样之差即该秒的速率。环形缓冲区只由控制线程读写
+typedef struct {
+    long long time_ns;  // 采样时刻 (单调时钟)
+    long long requests;
+    long long rx;
+    long long tx;
+    long long connections;  // 累计接受的连接数
+    long long active;
+} HistorySample;
+
+static HistorySample g_history[HISTORY_SECONDS + 1];  // 多留一个基准采样，满 HISTORY_SECONDS 个速率
+static unsigned g_history_next = 0;
+static unsigned g_history_count = 0;
+static long long g_history_base_ns = 0;  // 第一个采样 (控制线程启动) 的时刻，输出的 t 以它为起点
+
+static void history_sample(long long now_ns) {
+    HistorySample *sample = &g_history[g_history_next];
+    memset(sample, 0, sizeof(*sample));
+    if (g_history_count == 0)
+        g_history_base_ns = now_ns;
+    sample->time_ns = now_ns;
+    for (int i = 0; i < g_worker_count; i++) {
+        ThreadStats st;
+        stats_snapshot(&g_workers[i], &st);
+        sample->requests += st.total_requests;
+        sample->rx += st.total_bytes_recv;
+        sample->tx += st.total_bytes_sent;
+        sample->connections += st.total_connections;
+        sample->active += st.active_connections;
+    }
+    g_history_next = (g_history_next + 1) % (HISTORY_SECONDS + 1);
+    if (g_history_count < HISTORY_SECONDS + 1)
+        g_history_count++;
+}
+
+// history [N]: 最近 N 秒的每秒速率，从旧到新；返回 malloc 的 JSON，由调用方释放
+static char *history_json(int seconds) {
+    int rates = g_history_count > 0 ? (int)g_history_count - 1 : 0;
+    if (seconds <= 0 || seconds > rates)
+        seconds = rates;
+    size_t size = 128 + (size_t)seconds * 160;
+    char *buf = malloc(size);
+    if (!buf)
+        return NULL;
+    int off = snprintf(buf, size, "{\"interval_ms\":1000,\"capacity\":%d,\"samples\":[", HISTORY_SECONDS);
+    for (int k = seconds; k > 0; k--) {
+        const HistorySample *cur = &g_history[(g_history_next + HISTORY_SECONDS + 1 - k) % (HISTORY_SECONDS + 1)];
+        const HistorySample *prev = &g_history[(g_history_next + HISTORY_SECONDS - k) % (HISTORY_SECONDS + 1)];
+        double dt = (cur->time_ns - prev->time_ns) / 1e9;
+        if (dt <= 0)
+            dt = 1;
+        off += snprintf(buf + off, size - off,
+                        "%s{\"t\":%.1f,\"qps\":%.0f,\"rx_bps\":%.0f,\"tx_bps\":%.0f,\"conn_per_sec\":%.1f,"
+                        "\"active\":%lld}",
+                        k == seconds ? "" : ",", (cur->time_ns - g_history_base_ns) / 1e9,
+                        (cur->requests - prev->requests) / dt, (cur->rx - prev->rx) / dt, (cur->tx - prev->tx) / dt,
+                        (cur->connections - prev->connections) / dt, cur->active);
+    }
+    snprintf(buf + off, size - off, "]}\n");
+    return buf;
+}
+
+// 一个直方图的分位数 (微秒)
+static int latency_hist_json(char *buf, size_t size, const Histogram *hist) {
+    return snprintf(buf, size,
+                    "{\"count\":%llu,\"avg\":%.1f,\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"p999\":%.1f,"
+                    "\"max\":%.1f}",
+                    hist->total, hist->total ? hist->sum / 1000.0 / hist->total : 0.0,
+                    histogram_percentile(hist, 0.50) / 1000.0, histogram_percentile(hist, 0.90) / 1000.0,
+                    histogram_percentile(hist, 0.99) / 1000.0, histogram_percentile(hist, 0.999) / 1000.0,
+                    hist->max / 1000.0);
+}
+
+#ifdef ENABLE_TLS
+// 合并各 Worker 的握手耗时直方图 (TLS 连接总是记录，不需要 --latency)
+static void tls_hist_merge(Histogram *out) {
+    memset(out, 0, sizeof(Histogram));
+    for (int i = 0; i < g_worker_count; i++)
+        histogram_merge(out, &g_workers[i].lat_tls);
+}
+#endif
+
+// latency 命令: 合并各 Worker 的直方图 (Worker 不停写入，读到的是近似快照)，另给出每个 Worker 的分位数，
+// 用来区分尾延迟来自个别 Worker 的长批次还是内核
+static void latency_json(char *buf, size_t size) {
+    static Histogram merged[2];
+    memset(merged, 0, sizeof(merged));
+    for (int i = 0; i < g_worker_count; i++) {
+        histogram_merge(&merged[0], &g_workers[i].lat_service);
+        histogram_merge(&merged[1], &g_workers[i].lat_loop);
+    }
+    int off = snprintf(buf, size, "{\"enabled\":%s,\"unit\":\"us\",\"service\":",
+                       g_config.latency ? "true" : "false");
+    off += latency_hist_json(buf + off, size - off, &merged[0]);
+    off += snprintf(buf + off, size - off, ",\"loop\":");
+    off += latency_hist_json(buf + off, size - off, &merged[1]);
+#ifdef ENABLE_TLS
+    if (g_config.tls) {
+        static Histogram tls_hist;
+        tls_hist_merge(&tls_hist);
+        off += snprintf(buf + off, size - off, ",\"tls_handshake\":");
+        off += latency_hist_json(buf + off, size - off, &tls_hist);
+    }
+#endif
+    off += snprintf(buf + off, size - off, ",\"workers\":[");
+    for (int i = 0; i < g_worker_count && off < (int)size; i++) {
+        off += snprintf(buf + off, size - off, "%s{\"id\":%d,\"service\":", i ? "," : "", i);
+        if (off < (int)size)
+            off += latency_hist_json(buf + off, size - off, &g_workers[i].lat_service);
+        if (off < (int)size)
+            off += snprintf(buf + off, size - off, ",\"loop\":");
+        if (off < (int)size)
+            off += latency_hist_json(buf + off, size - off, &g_workers[i].lat_loop);
+        if (off < (int)size)
+            off += snprintf(buf + off, size - off, "}");
+    }
+    if (off < (int)size)
+        snprintf(buf + off, size - off, "]}\n");
+}
+
 void *control_thread(void *arg) {
     (void)arg;
     unlink(CONTROL_SOCKET);
@@ -347,7 +3809,19 @@ void *control_thread(void *arg) {
         return NULL;
     listen(sock, 5);
 
+    // 等待命令的同时每秒采样一次 history
+    long long next_sample_ns = monitor_get_time_ns();
     while (running) {
+        long long now_ns = monitor_get_time_ns();
+        if (now_ns >= next_sample_ns) {
+            history_sample(now_ns);
+            next_sample_ns += 1000000000LL;
+            if (next_sample_ns <= now_ns)
+                next_sample_ns = now_ns + 1000000000LL;
+        }
+        struct pollfd pfd = {.fd = sock, .events = POLLIN};
+        if (poll(&pfd, 1, (int)((next_sample_ns - now_ns + 999999) / 1000000)) <= 0)
+            continue;
         int client = accept(sock, NULL, NULL);
         if (client < 0)
             continue;
@@ -355,29 +3829,259 @@ void *control_thread(void *arg) {
         char cmd[256] = {0};
         if (read(client, cmd, sizeof(cmd) - 1) > 0) {
             cmd[strcspn(cmd, "\r\n")] = 0;
-            char response[4096];
+            char response[16384];
+            char *out = response;  // history 的输出较长，单独分配
 
             if (strcmp(cmd, "stats") == 0) {
-                long long total_conn = 0, active_conn = 0, total_req = 0, rx = 0, tx = 0;
+                long long total_conn = 0, active_conn = 0, total_req = 0, rx = 0, tx = 0, nobufs = 0;
+                long long zc_sends = 0, zc_copied = 0, submits = 0, submits_skipped = 0, iterations = 0, cqes = 0;
+                long long link_chains = 0, link_breaks = 0, pipe_misses = 0;
+                long long pl_writes = 0, pl_iovecs = 0, pl_stalls = 0, short_writes = 0;
+                long long st_writes = 0, st_iovecs = 0, st_stalls = 0, st_chunks = 0, st_chunks_peak = 0;
+                long long st_fallback = 0, conn_bytes = 0, buffer_bytes = 0;
+                long long slab_capacity = 0, slab_in_use = 0, slab_high_water = 0, slab_fallback = 0;
+                long long sq_full = 0, sq_deferred = 0, deferred_now = 0, deferred_peak = 0, cq_overflow = 0;
+                long long cq_dropped = 0;
+                long long spin_hits = 0, spin_misses = 0, spin_us = 0, blocking_waits = 0, worker_cpu_ns = 0;
+                long long spin_cur_us = 0;
+                long long steal_requests = 0, migrations_out = 0, migrations_in = 0, migrate_failed = 0;
+                long long idle_timeouts = 0, write_timeouts = 0;
+                long long udp_rx = 0, udp_tx = 0, udp_rx_bytes = 0, udp_tx_bytes = 0, udp_batches = 0;
+                long long udp_gro_msgs = 0, udp_gso_msgs = 0, udp_dropped = 0, unix_conn = 0;
+                long long tls_handshakes = 0, tls_failed = 0, tls_timeouts = 0, tls_pending = 0, tls_handshake_us = 0;
+                double tls_p99_us = 0, tls_max_us = 0;
+                long long fr_writes = 0, fr_compacts = 0, fr_compact_bytes = 0, fr_errors = 0, fr_delay_us = 0;
+                long long co_flushes = 0, co_msg_more = 0, co_switches = 0, co_batched = 0, sockopt_failed = 0;
+                int napi = 0;
+                long long conn_min = LLONG_MAX, conn_max = 0;
+                unsigned long long lb_least = 0, lb_syn_cpu = 0, lb_fallback = 0;
                 for (int i = 0; i < g_worker_count; i++) {
-                    total_conn += g_workers[i].stats.total_connections;
-                    active_conn += g_workers[i].stats.active_connections;
-                    total_req += g_workers[i].stats.total_requests;
-                    rx += g_workers[i].stats.total_bytes_recv;
-                    tx += g_workers[i].stats.total_bytes_sent;
+                    ThreadStats st;
+                    stats_snapshot(&g_workers[i], &st);
+                    total_conn += st.total_connections;
+                    active_conn += st.active_connections;
+                    total_req += st.total_requests;
+                    rx += st.total_bytes_recv;
+                    tx += st.total_bytes_sent;
+                    nobufs += st.buf_ring_exhausted;
+                    zc_sends += st.zc_sends;
+                    zc_copied += st.zc_copied;
+                    submits += st.submit_calls;
+                    submits_skipped += st.submit_skipped;
+                    iterations += st.loop_iterations;
+                    cqes += st.cqes_processed;
+                    link_chains += st.link_chains;
+                    link_breaks += st.link_breaks;
+                    pipe_misses += st.pipe_pool_misses;
+                    pl_writes += st.pipeline_writes;
+                    pl_iovecs += st.pipeline_iovecs;
+                    pl_stalls += st.pipeline_stalls;
+                    short_writes += st.short_writes;
+                    st_writes += st.stream_writes;
+                    st_iovecs += st.stream_iovecs;
+                    st_stalls += st.stream_stalls;
+                    fr_writes += st.framed_writes;
+                    fr_compacts += st.framed_compacts;
+                    fr_compact_bytes += st.framed_compact_bytes;
+                    fr_errors += st.framed_errors;
+                    fr_delay_us += st.framed_delay_us;
+                    co_flushes += st.coalesce_flushes;
+                    co_msg_more += st.coalesce_msg_more;
+                    co_switches += st.coalesce_switches;
+                    co_batched += st.coalesce_batched;
+                    sockopt_failed += st.sockopt_failed;
+                    st_chunks += st.chunk_in_use;
+                    st_chunks_peak += st.chunk_high_water;
+                    st_fallback += st.chunk_fallback;
+                    conn_bytes += st.conn_in_use * g_workers[i].conn_pool.obj_size;
+                    buffer_bytes += st.chunk_in_use * g_workers[i].chunk_pool.obj_size;
+                    if (g_config.echo_mode == ECHO_MULTISHOT)
+                        buffer_bytes += (long long)g_config.buf_ring_entries * g_config.buf_size;
+                    slab_capacity += g_workers[i].conn_pool.capacity;
+                    slab_in_use += st.conn_in_use;
+                    slab_high_water += st.conn_high_water;
+                    slab_fallback += st.conn_fallback;
+                    sq_full += st.sq_full;
+                    sq_deferred += st.sq_deferred;
+                    deferred_now += st.deferred_now;
+                    deferred_peak += st.deferred_peak;
+                    cq_overflow += st.cq_overflow;
+                    cq_dropped += st.cq_dropped;
+                    spin_hits += st.spin_hits;
+                    spin_misses += st.spin_misses;
+                    spin_us += st.spin_us;
+                    if (i == 0)
+                        spin_cur_us = st.spin_cur_us;
+                    blocking_waits += st.blocking_waits;
+                    napi += g_workers[i].napi;
+                    steal_requests += st.steal_requests;
+                    migrations_out += st.migrations_out;
+                    migrations_in += st.migrations_in;
+                    migrate_failed += st.migrate_failed;
+                    idle_timeouts += st.idle_timeouts;
+                    write_timeouts += st.write_timeouts;
+                    udp_rx += st.udp_rx;
+                    udp_tx += st.udp_tx;
+                    udp_rx_bytes += st.udp_rx_bytes;
+                    udp_tx_bytes += st.udp_tx_bytes;
+                    udp_batches += st.udp_batches;
+                    udp_gro_msgs += st.udp_gro_msgs;
+                    udp_gso_msgs += st.udp_gso_msgs;
+                    udp_dropped += st.udp_dropped;
+                    unix_conn += st.unix_connections;
+                    tls_handshakes += st.tls_handshakes;
+                    tls_failed += st.tls_failed;
+                    tls_timeouts += st.tls_timeouts;
+                    tls_pending += st.tls_pending;
+                    tls_handshake_us += st.tls_handshake_us;
+                    if (st.active_connections < conn_min)
+                        conn_min = st.active_connections;
+                    if (st.active_connections > conn_max)
+                        conn_max = st.active_connections;
+                    // Worker 线程的 CPU 时间由控制线程读取，Worker 自身不计时
+                    clockid_t cid;
+                    struct timespec cpu_ts;
+                    if (pthread_getcpuclockid(g_workers[i].thread_handle, &cid) == 0 &&
+                        clock_gettime(cid, &cpu_ts) == 0)
+                        worker_cpu_ns += cpu_ts.tv_sec * 1000000000LL + cpu_ts.tv_nsec;
                 }
 
+#ifdef ENABLE_EBPF
+                if (g_reuseport)
+                    reuseport_loader_get_stats(g_reuseport, &lb_least, &lb_syn_cpu, &lb_fallback);
+#endif
+#ifdef ENABLE_TLS
+                // 握手耗时的尾部: 卡住的握手在平均值里会被大量正常握手稀释
+                if (g_config.tls) {
+                    static Histogram tls_hist;
+                    tls_hist_merge(&tls_hist);
+                    tls_p99_us = histogram_percentile(&tls_hist, 0.99) / 1000.0;
+                    tls_max_us = tls_hist.max / 1000.0;
+                }
+#endif
+                // 连接倾斜: 最忙 Worker 的活跃连接数相对平均值的倍数
+                double conn_skew = active_conn ? (double)conn_max * g_worker_count / active_conn : 0.0;
+
                 SystemStats sys_stats;
                 monitor_collect(g_monitor, &sys_stats);
                 long long uptime = (monitor_get_time_us() - g_start_time_us) / 1000000;
+                // 内核侧只能拿到全系统的 TCP socket 缓冲区占用，空闲连接通常为 0
+                long tcp_inuse = 0, tcp_mem_pages = 0;
+                monitor_get_tcp_sockstat(&tcp_inuse, &tcp_mem_pages);
+                // 每请求的 TCP 段数与网络软中断数: 全系统计数，机器上只有本压测流量时才有意义
+                long long segs[2] = {0, 0};
+                long long softirqs = monitor_get_net_softirqs();
+                monitor_get_tcp_segments(&segs[0], &segs[1]);
+                double segs_in_per_req = total_req ? (double)(segs[0] - g_start_segs[0]) / total_req : 0.0;
+                double segs_out_per_req = total_req ? (double)(segs[1] - g_start_segs[1]) / total_req : 0.0;
+                double softirq_per_req = 0.0;
+                if (total_req && softirqs >= 0 && g_start_softirqs >= 0)
+                    softirq_per_req = (double)(softirqs - g_start_softirqs) / total_req;
 
                 snprintf(response, sizeof(response),
-                         "{\"status\":\"running\",\"mode\":\"io_uring\",\"uptime\":%lld,"
+                         "{\"status\":\"running\",\"mode\":\"%s\",\"echo\":\"%s\",\"fixed_files\":%u,"
+                         "\"uptime\":%lld,"
                          "\"connections\":{\"total\":%lld,\"active\":%lld},"
-                         "\"traffic\":{\"requests\":%lld,\"rx\":%lld,\"tx\":%lld},"
+                         "\"traffic\":{\"requests\":%lld,\"rx\":%lld,\"tx\":%lld,\"short_writes\":%lld},"
+                         "\"buffers\":{\"ring_exhausted\":%lld},"
+                         "\"zero_copy\":{\"sends\":%lld,\"copied\":%lld},"
+                         "\"submit\":{\"sqpoll\":%s,\"calls\":%lld,\"syscalls_avoided\":%lld},"
+                         "\"loop\":{\"defer_taskrun\":%s,\"min_batch\":%u,\"iterations\":%lld,\"cqes\":%lld,"
+                         "\"avg_batch\":%.2f},"
+                         "\"link\":{\"depth\":%u,\"chains\":%lld,\"breaks\":%lld},"
+                         "\"splice\":{\"pipe_pool\":%u,\"pipe_misses\":%lld},"
+                         "\"pipeline\":{\"depth\":%u,\"writes\":%lld,\"iovecs\":%lld,\"avg_iovecs\":%.2f,"
+                         "\"stalls\":%lld},"
+                         "\"stream\":{\"max_msg\":%u,\"writes\":%lld,\"iovecs\":%lld,\"stalls\":%lld,\"chunks\":%lld,"
+                         "\"chunks_peak\":%lld,\"chunk_fallback\":%lld},"
+                         "\"framed\":{\"writes\":%lld,\"avg_frames\":%.2f,\"compacts\":%lld,\"compact_bytes\":%lld,"
+                         "\"errors\":%lld,\"avg_delay_us\":%.1f},"
+                         "\"coalesce\":{\"enabled\":%s,\"flushes\":%lld,\"msg_more\":%lld,\"switches\":%lld,"
+                         "\"batched_conns\":%lld,\"sockopt_failed\":%lld,\"segs_in_per_req\":%.3f,"
+                         "\"segs_out_per_req\":%.3f,\"net_softirq_per_req\":%.3f},"
+                         "\"memory\":{\"idle_conn_bytes\":%zu,\"conn_bytes\":%lld,\"buffer_bytes\":%lld,"
+                         "\"per_conn_bytes\":%.1f,\"rcvbuf\":%d,\"sndbuf\":%d,\"tcp_sockets\":%ld,\"tcp_mem_kb\":%ld},"
+                         "\"slab\":{\"pages\":\"%s\",\"obj_size\":%zu,\"capacity\":%lld,\"in_use\":%lld,"
+                         "\"high_water\":%lld,\"fallback\":%lld},"
+                         "\"backpressure\":{\"sq_full\":%lld,\"deferred\":%lld,\"queued\":%lld,\"queued_peak\":%lld,"
+                         "\"cq_overflow\":%lld,\"cq_dropped\":%lld},"
+                         "\"busy_poll\":{\"napi\":%d,\"busy_poll_us\":%u,\"budget\":%u,\"prefer\":%s,"
+                         "\"spin_max_us\":%u,\"spin_cur_us\":%lld,\"spin_hits\":%lld,\"spin_misses\":%lld,"
+                         "\"spin_ms\":%.1f,\"blocking_waits\":%lld,\"worker_cpu_ms\":%.1f,\"cpu_ns_per_req\":%.0f},"
+                         "\"dispatch\":{\"bpf\":%s,\"prefer_syn_cpu\":%s,\"least_loaded\":%llu,\"syn_cpu\":%llu,"
+                         "\"fallback\":%llu,\"conn_min\":%lld,\"conn_max\":%lld,\"skew\":%.2f},"
+                         "\"migration\":{\"enabled\":%s,\"threshold\":%u,\"interval_ms\":%u,\"steal_requests\":%lld,"
+                         "\"out\":%lld,\"in\":%lld,\"failed\":%lld},"
+                         "\"timeouts\":{\"idle_ms\":%u,\"write_ms\":%u,\"idle\":%lld,\"write\":%lld},"
+                         "\"udp\":{\"enabled\":%s,\"gso\":%s,\"gro\":%s,\"rx\":%lld,\"tx\":%lld,\"rx_bytes\":%lld,"
+                         "\"tx_bytes\":%lld,\"batches\":%lld,\"avg_batch\":%.2f,\"gro_msgs\":%lld,\"gso_msgs\":%lld,"
+                         "\"dropped\":%lld},"
+                         "\"unix\":{\"path\":\"%s\",\"connections\":%lld},"
+                         "\"tls\":{\"mode\":\"%s\",\"handshakes\":%lld,\"failed\":%lld,\"timeouts\":%lld,"
+                         "\"pending\":%lld,\"avg_handshake_us\":%.1f,\"p99_handshake_us\":%.1f,"
+                         "\"max_handshake_us\":%.1f},"
                          "\"system\":{\"cpu\":%.2f,\"mem_mb\":%.2f,\"threads\":%d}}\n",
-                         uptime, total_conn, active_conn, total_req, rx, tx, sys_stats.cpu_usage_percent,
+                         BACKEND_NAMES[g_config.backend], ECHO_MODE_NAMES[g_config.echo_mode], g_config.fixed_files,
+                         uptime, total_conn, active_conn, total_req, rx, tx, short_writes, nobufs, zc_sends, zc_copied,
+                         g_config.sqpoll ? "true" : "false", submits,
+                         submits_skipped, g_config.defer_taskrun ? "true" : "false", g_config.min_batch, iterations,
+                         cqes, iterations ? (double)cqes / iterations : 0.0, g_config.link_depth, link_chains,
+                         link_breaks, g_config.pipe_pool, pipe_misses, g_config.pipeline_depth, pl_writes, pl_iovecs,
+                         pl_writes ? (double)pl_iovecs / pl_writes : 0.0, pl_stalls, g_config.max_msg, st_writes,
+                         st_iovecs, st_stalls, st_chunks, st_chunks_peak, st_fallback, fr_writes,
+                         fr_writes ? (double)total_req / fr_writes : 0.0, fr_compacts, fr_compact_bytes, fr_errors,
+                         g_config.echo_mode == ECHO_FRAMED && total_req ? (double)fr_delay_us / total_req : 0.0,
+                         g_config.coalesce ? "true" : "false", co_flushes, co_msg_more, co_switches, co_batched,
+                         sockopt_failed, segs_in_per_req, segs_out_per_req, softirq_per_req,
+                         g_workers[0].conn_pool.obj_size,
+                         conn_bytes, buffer_bytes,
+                         active_conn ? (double)(conn_bytes + buffer_bytes) / active_conn : 0.0,
+                         g_config.rcvbuf, g_config.sndbuf, tcp_inuse, tcp_mem_pages * (sysconf(_SC_PAGESIZE) / 1024),
+                         slab_page_type_name(g_workers[0].conn_pool.page_type), g_workers[0].conn_pool.obj_size,
+                         slab_capacity, slab_in_use, slab_high_water, slab_fallback, sq_full, sq_deferred,
+                         deferred_now, deferred_peak, cq_overflow, cq_dropped, napi, g_config.busy_poll_us,
+                         g_config.busy_poll_budget, g_config.prefer_busy_poll ? "true" : "false", g_config.spin_us,
+                         spin_cur_us, spin_hits, spin_misses, spin_us / 1000.0, blocking_waits,
+                         worker_cpu_ns / 1e6, total_req ? (double)worker_cpu_ns / total_req : 0.0,
+                         g_config.reuseport_lb ? "true" : "false", g_config.prefer_syn_cpu ? "true" : "false", lb_least,
+                         lb_syn_cpu, lb_fallback, conn_min, conn_max, conn_skew,
+                         g_config.migrate ? "true" : "false", g_config.migrate_threshold, g_config.migrate_interval_ms,
+                         steal_requests, migrations_out, migrations_in, migrate_failed, g_config.idle_timeout_ms,
+                         g_config.write_timeout_ms, idle_timeouts, write_timeouts, g_config.udp ? "true" : "false",
+                         g_config.udp_gso ? "true" : "false", g_config.udp_gro ? "true" : "false", udp_rx, udp_tx,
+                         udp_rx_bytes, udp_tx_bytes, udp_batches, udp_batches ? (double)udp_rx / udp_batches : 0.0,
+                         udp_gro_msgs, udp_gso_msgs, udp_dropped, g_config.unix_path ? g_config.unix_path : "",
+                         unix_conn, TLS_MODE_NAMES[g_config.tls], tls_handshakes, tls_failed, tls_timeouts, tls_pending,
+                         tls_handshakes ? (double)tls_handshake_us / tls_handshakes : 0.0, tls_p99_us, tls_max_us,
+                         sys_stats.cpu_usage_percent,
                          sys_stats.memory_rss_kb / 1024.0, g_worker_count);
+            } else if (strncmp(cmd, "history", 7) == 0 && (cmd[7] == '\0' || cmd[7] == ' ')) {
+                out = history_json(cmd[7] ? atoi(cmd + 8) : HISTORY_DEFAULT);
+                if (!out) {
+                    out = response;
+                    snprintf(response, sizeof(response), "{\"error\":\"out_of_memory\"}\n");
+                }
+            } else if (strcmp(cmd, "latency") == 0) {
+                latency_json(response, sizeof(response));
+            } else if (strcmp(cmd, "zc") == 0) {
+                // 每档: 两条路径的发送次数与每 KB 线程 CPU 开销 (ns)
+                ZcStats total;
+                long long crossover = zc_crossover(&total);
+                int off = snprintf(response, sizeof(response),
+                                   "{\"threshold\":%u,\"auto\":%s,\"crossover\":%lld,\"classes\":[",
+                                   g_config.zc_threshold, g_config.zc_auto ? "true" : "false", crossover);
+                for (int c = 0; c < ZC_SIZE_CLASSES && off < (int)sizeof(response); c++) {
+                    double cost[2];
+                    for (int p = 0; p < 2; p++)
+                        cost[p] = total.bytes[p][c] ? total.cpu_ns[p][c] * 1024.0 / total.bytes[p][c] : 0;
+                    off += snprintf(response + off, sizeof(response) - off,
+                                    "%s{\"size\":%lld,\"copy\":{\"ops\":%lld,\"ns_per_kb\":%.1f},"
+                                    "\"zc\":{\"ops\":%lld,\"ns_per_kb\":%.1f}}",
+                                    c ? "," : "", 1LL << (ZC_MIN_SHIFT + c), total.ops[0][c], cost[0],
+                                    total.ops[1][c], cost[1]);
+                }
+                if (off < (int)sizeof(response))
+                    snprintf(response + off, sizeof(response) - off, "]}\n");
             } else if (strcmp(cmd, "shutdown") == 0) {
                 snprintf(response, sizeof(response), "{\"status\":\"shutting_down\"}\n");
                 write(client, response, strlen(response));
@@ -386,7 +4090,9 @@ void *control_thread(void *arg) {
             } else {
                 snprintf(response, sizeof(response), "{\"error\":\"unknown_command\"}\n");
             }
-            write(client, response, strlen(response));
+            write(client, out, strlen(out));
+            if (out != response)
+                free(out);
         }
         close(client);
     }
@@ -398,7 +4104,519 @@ void *control_thread(void *arg) {
 // ==========================================
 // 主函数
 // ==========================================
+void print_usage(const char *prog) {
+    printf("用法: %s [选项] [线程数]\n\n", prog);
+    printf("选项:\n");
+    printf("  -t, --threads NUM       Worker 线程数 (默认: CPU 核心数)\n");
+    printf("  -b, --backend NAME      事件循环后端 (默认: io_uring)\n");
+    printf("                            io_uring - 下列 io_uring 选项均适用\n");
+    printf("                            epoll    - epoll 边缘触发 + 非阻塞 recv/send，忽略 io_uring 专有选项\n");
+    printf("                          io_uring 被内核或 seccomp 禁用时自动回退到 epoll\n");
+    printf("  -e, --echo-mode MODE    回显数据路径 (默认: classic)\n");
+    printf("                            classic   - 单次 accept + readv/writev，每连接独占缓冲区\n");
+    printf("                            multishot - multishot accept/recv + provided buffer ring\n");
+    printf("                            linked    - read→send 以 IOSQE_IO_LINK 成链提交，每条链一个 CQE\n");
+    printf("                            splice    - socket→pipe→socket 的 splice 链，数据不进入用户态\n");
+    printf("                            pipelined - 每连接多个读缓冲槽位，读写解耦，排队回显合并为一次 writev\n");
+    printf("                            stream    - 大消息流式回显，数据读入块链表，输出队列处理短写\n");
+    printf("                            sparse    - 空闲连接只挂 POLL_ADD，有数据时才从共享池取 buffer\n");
+    printf("                            framed    - 长度前缀帧协议，按完整帧回显，多帧合并写出 (client --framed)\n");
+    printf("  -B, --buf-ring NUM      multishot 模式下每个 Worker 的 buffer 数 (2 的幂, 默认: %d)\n",
+           DEFAULT_BUF_RING_ENTRIES);
+    printf("  -S, --buf-size BYTES    单次读缓冲区大小 (默认: %d, 最大: %d)\n", BUFFER_SIZE, MAX_BUFFER_SIZE);
+    printf("  -z, --zc-threshold N    回显长度 >= N 字节时使用 SEND_ZC 零拷贝发送 (默认: 0=关闭)\n");
+    printf("                          auto: 交替使用 copy/zc 并测量交叉点 (控制命令 zc 查看)\n");
+    printf("  -F, --fixed-files NUM   每个 ring 注册 NUM 个槽位的 fixed file 表，accept 直接进表 (默认: 0=关闭)\n");
+    printf("      --sqpoll            使用 SQPOLL 内核线程轮询提交队列 (提交无需系统调用)\n");
+    printf("      --sqpoll-cpus LIST  SQPOLL 线程绑定的 CPU 列表 (如 2,3 或 8-11)，Worker 会避开这些 CPU\n");
+    printf("      --client-cpus LIST  保留给 client 的 CPU 列表，Worker 不会使用 (client 用 taskset -c LIST 运行)\n");
+    printf("      --numa-nic IFACE    Worker 优先占满该网卡所在的 NUMA 节点 (默认: 各节点轮流分配)\n");
+    printf("      --sqpoll-idle MS    SQPOLL 线程空闲多久后休眠 (默认: %d)\n", DEFAULT_SQPOLL_IDLE_MS);
+    printf("      --defer-taskrun     SINGLE_ISSUER + DEFER_TASKRUN ring，每轮一次 submit_and_wait (与 SQPOLL 互斥)\n");
+    printf("      --min-batch NUM     DEFER_TASKRUN 模式每轮至少等待的 CQE 数 (默认: 1)\n");
+    printf("      --batch-wait US     凑不齐 min-batch 时的最长等待微秒数 (默认: %d)\n", DEFAULT_BATCH_WAIT_US);
+    printf("      --link-depth NUM    linked 模式每条链的 read→send 对数 (默认: %d, 最大: %d)\n", DEFAULT_LINK_DEPTH,
+           MAX_LINK_DEPTH);
+    printf("      --pipe-pool NUM     splice 模式每个 Worker 预先创建的 pipe 数 (默认: %d)\n", DEFAULT_PIPE_POOL);
+    printf("      --pipeline-depth N  pipelined 模式每连接的读缓冲槽位数 (默认: %d, 最大: %d)\n",
+           DEFAULT_PIPELINE_DEPTH, MAX_PIPELINE_DEPTH);
+    printf("      --rcvbuf BYTES      监听 socket 的 SO_RCVBUF，新连接继承 (默认: 0=内核自动调节)\n");
+    printf("      --sndbuf BYTES      监听 socket 的 SO_SNDBUF，新连接继承 (默认: 0=内核自动调节)\n");
+    printf("      --max-msg BYTES     stream 模式每连接最多缓冲的未回显字节数 (默认: %d, 最大: %d)\n", DEFAULT_MAX_MSG,
+           MAX_MAX_MSG);
+    printf("      --slab NUM          每个 Worker 连接对象池预分配的对象数，0 表示使用 malloc (默认: %d)\n",
+           DEFAULT_SLAB_OBJECTS);
+    printf("      --slab-hugepages    对象池使用 2MB 大页 (hugetlb 不可用时退回透明大页)\n");
+    printf("      --busy-poll US      NAPI busy poll 时长: 注册到 ring (Linux >= 6.9) 并设置 SO_BUSY_POLL (默认: 0=关闭)\n");
+    printf("      --busy-poll-budget N  每次 busy poll 最多处理的包数 (SO_BUSY_POLL_BUDGET, 默认: 内核默认)\n");
+    printf("      --prefer-busy-poll  busy poll 期间抑制网卡软中断 (SO_PREFER_BUSY_POLL)\n");
+    printf("      --spin US           阻塞等待前自旋轮询 CQ 的最长微秒数，按命中率自适应收缩 (默认: 0=关闭)\n");
+    printf("      --migrate           classic 模式: 空闲 Worker 从最忙的 Worker 窃取连接 (IORING_OP_MSG_RING 移交)\n");
+    printf("      --migrate-threshold PCT  负载偏离平均值超过 PCT%% 才迁移 (默认: %d)\n", DEFAULT_MIGRATE_THRESHOLD);
+    printf("      --migrate-interval MS    负载统计窗口，每窗口每个 Worker 最多迁出一个连接 (默认: %d)\n",
+           DEFAULT_MIGRATE_INTERVAL_MS);
+    printf("      --idle-timeout MS   连接在 MS 毫秒内没有收到数据则关闭 (classic/sparse 模式与 epoll 后端, 默认: 0=不限)\n");
+    printf("      --write-timeout MS  回显写出 MS 毫秒没有进展 (对端不读) 则关闭 (同上, 默认: 0=不限)\n");
+    printf("      --udp               同端口上提供 UDP 回显 (每个 Worker 一个 SO_REUSEPORT socket, recvmmsg/sendmmsg)\n");
+    printf("      --udp-gso           UDP 回显合并发送: 同一对端同样长度的连续数据报一次发出 (UDP_SEGMENT, 隐含 --udp)\n");
+    printf("      --udp-gro           UDP 接收合并 (UDP_GRO, 隐含 --udp-gso)\n");
+    printf("      --unix PATH         同时在 Unix 域 socket 上提供回显 (@name 为抽象命名空间)，与 TCP 回环对比\n");
+    printf("      --tls MODE          TLS 1.3 回显 (server_tls 版本): ktls=密钥装入内核, user=用户态加解密 (classic 模式)\n");
+    printf("      --tls-cert FILE     PEM 证书链 (默认: 启动时生成临时自签名证书)\n");
+    printf("      --tls-key FILE      PEM 私钥 (默认: 与 --tls-cert 同一文件)\n");
+    printf("      --coalesce          小消息写合并: 新连接 TCP_NODELAY；pipelined/framed 模式每批 CQE 每连接只写一次，\n");
+    printf("                          按每次写合并的消息数切换 TCP_QUICKACK (stats 中查看每请求的 TCP 段数)\n");
+    printf("      --latency           记录服务端服务时间与事件循环每轮耗时的直方图 (控制命令 latency 查看分位数)\n");
+    printf("      --reuseport-lb      eBPF 版本: SO_REUSEPORT 选择程序把新连接分派给负载最低的 Worker\n");
+    printf("      --prefer-syn-cpu N  同上，并优先选择收到 SYN 的 CPU 上的 Worker (负载最多高出 N)\n");
+    printf("  -h, --help              显示此帮助信息\n\n");
+    printf("示例:\n");
+    printf("  %s 4                          # 4 个 Worker\n", prog);
+    printf("  %s -t 4 -e multishot -B 8192  # multishot + 每 Worker 8192 个 buffer\n", prog);
+    printf("  %s -S 65536 -z auto           # 64KB 缓冲区, 测量零拷贝交叉点\n", prog);
+    printf("  %s -t 2 --sqpoll --sqpoll-cpus 6,7  # 2 个 Worker, SQPOLL 线程独占 CPU 6/7\n", prog);
+    printf("  %s --defer-taskrun --min-batch 8    # 每次进入内核至少收割 8 个 CQE\n", prog);
+    printf("  %s -t 4 -b epoll                # epoll 后端，与 io_uring 对比\n", prog);
+    printf("  %s -e stream -S 65536           # 64KB 块的流式回显，配合 client -s 1048576\n", prog);
+    printf("  %s -e framed -S 65536           # 帧协议回显，单帧最大 64KB，配合 client --framed -p 16\n", prog);
+    printf("  %s -e framed --coalesce       # 帧协议回显 + 写合并，对比 stats 中的 segs_out_per_req\n", prog);
+    printf("  %s --latency                  # echo latency | nc -U %s 查看服务端 p50/p99/p99.9\n", prog,
+           CONTROL_SOCKET);
+    printf("  %s -e sparse --rcvbuf 8192 --sndbuf 8192  # 海量空闲连接，限制每连接内核缓冲区\n", prog);
+    printf("  %s --busy-poll 50 --prefer-busy-poll --spin 20  # 以 CPU 换尾延迟，stats 中查看 busy_poll 开销\n", prog);
+    printf("  %s -t 2 --unix @echo            # TCP 8888 与抽象 Unix 域 socket @echo 同时回显\n", prog);
+    printf("  ./out/server_tls -t 4 --tls ktls            # kTLS 回显，与 --tls user 对比每核吞吐 (client_tls --tls ktls)\n");
+    printf("\n");
+}
+
+static int parse_backend(const char *name, BackendType *backend) {
+    for (size_t i = 0; i < sizeof(BACKEND_NAMES) / sizeof(BACKEND_NAMES[0]); i++) {
+        if (strcmp(name, BACKEND_NAMES[i]) == 0) {
+            *backend = (BackendType)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// 探测 io_uring 是否可用: 容器 seccomp 策略、kernel.io_uring_disabled 或老内核都会让 setup 失败
+static int uring_available() {
+    struct io_uring ring;
+    int ret = io_uring_queue_init(2, &ring, 0);
+    if (ret == -EPERM || ret == -ENOSYS || ret == -EACCES)
+        return 0;
+    if (ret == 0)
+        io_uring_queue_exit(&ring);
+    return 1;
+}
+
+static int parse_echo_mode(const char *name, EchoMode *mode) {
+    for (size_t i = 0; i < sizeof(ECHO_MODE_NAMES) / sizeof(ECHO_MODE_NAMES[0]); i++) {
+        if (strcmp(name, ECHO_MODE_NAMES[i]) == 0) {
+            *mode = (EchoMode)i;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+// 仅有长选项的参数
+enum {
+    OPT_SQPOLL = 256,
+    OPT_SQPOLL_CPUS,
+    OPT_SQPOLL_IDLE,
+    OPT_DEFER_TASKRUN,
+    OPT_MIN_BATCH,
+    OPT_BATCH_WAIT,
+    OPT_LINK_DEPTH,
+    OPT_PIPE_POOL,
+    OPT_PIPELINE_DEPTH,
+    OPT_MAX_MSG,
+    OPT_RCVBUF,
+    OPT_SNDBUF,
+    OPT_SLAB,
+    OPT_SLAB_HUGEPAGES,
+    OPT_BUSY_POLL,
+    OPT_BUSY_POLL_BUDGET,
+    OPT_PREFER_BUSY_POLL,
+    OPT_SPIN,
+    OPT_REUSEPORT_LB,
+    OPT_PREFER_SYN_CPU,
+    OPT_CLIENT_CPUS,
+    OPT_NUMA_NIC,
+    OPT_MIGRATE,
+    OPT_MIGRATE_THRESHOLD,
+    OPT_MIGRATE_INTERVAL,
+    OPT_IDLE_TIMEOUT,
+    OPT_WRITE_TIMEOUT,
+    OPT_UDP,
+    OPT_UDP_GSO,
+    OPT_UDP_GRO,
+    OPT_UNIX,
+    OPT_TLS,
+    OPT_TLS_CERT,
+    OPT_TLS_KEY,
+    OPT_COALESCE,
+    OPT_LATENCY
+};
+
 int main(int argc, char *argv[]) {
+    static struct option long_options[] = {{"threads", required_argument, 0, 't'},
+                                           {"backend", required_argument, 0, 'b'},
+                                           {"echo-mode", required_argument, 0, 'e'},
+                                           {"buf-ring", required_argument, 0, 'B'},
+                                           {"buf-size", required_argument, 0, 'S'},
+                                           {"zc-threshold", required_argument, 0, 'z'},
+                                           {"fixed-files", required_argument, 0, 'F'},
+                                           {"sqpoll", no_argument, 0, OPT_SQPOLL},
+                                           {"sqpoll-cpus", required_argument, 0, OPT_SQPOLL_CPUS},
+                                           {"sqpoll-idle", required_argument, 0, OPT_SQPOLL_IDLE},
+                                           {"defer-taskrun", no_argument, 0, OPT_DEFER_TASKRUN},
+                                           {"min-batch", required_argument, 0, OPT_MIN_BATCH},
+                                           {"batch-wait", required_argument, 0, OPT_BATCH_WAIT},
+                                           {"link-depth", required_argument, 0, OPT_LINK_DEPTH},
+                                           {"pipe-pool", required_argument, 0, OPT_PIPE_POOL},
+                                           {"pipeline-depth", required_argument, 0, OPT_PIPELINE_DEPTH},
+                                           {"max-msg", required_argument, 0, OPT_MAX_MSG},
+                                           {"rcvbuf", required_argument, 0, OPT_RCVBUF},
+                                           {"sndbuf", required_argument, 0, OPT_SNDBUF},
+                                           {"slab", required_argument, 0, OPT_SLAB},
+                                           {"slab-hugepages", no_argument, 0, OPT_SLAB_HUGEPAGES},
+                                           {"busy-poll", required_argument, 0, OPT_BUSY_POLL},
+                                           {"busy-poll-budget", required_argument, 0, OPT_BUSY_POLL_BUDGET},
+                                           {"prefer-busy-poll", no_argument, 0, OPT_PREFER_BUSY_POLL},
+                                           {"spin", required_argument, 0, OPT_SPIN},
+                                           {"reuseport-lb", no_argument, 0, OPT_REUSEPORT_LB},
+                                           {"prefer-syn-cpu", required_argument, 0, OPT_PREFER_SYN_CPU},
+                                           {"client-cpus", required_argument, 0, OPT_CLIENT_CPUS},
+                                           {"numa-nic", required_argument, 0, OPT_NUMA_NIC},
+                                           {"migrate", no_argument, 0, OPT_MIGRATE},
+                                           {"migrate-threshold", required_argument, 0, OPT_MIGRATE_THRESHOLD},
+                                           {"migrate-interval", required_argument, 0, OPT_MIGRATE_INTERVAL},
+                                           {"idle-timeout", required_argument, 0, OPT_IDLE_TIMEOUT},
+                                           {"write-timeout", required_argument, 0, OPT_WRITE_TIMEOUT},
+                                           {"udp", no_argument, 0, OPT_UDP},
+                                           {"udp-gso", no_argument, 0, OPT_UDP_GSO},
+                                           {"udp-gro", no_argument, 0, OPT_UDP_GRO},
+                                           {"unix", required_argument, 0, OPT_UNIX},
+                                           {"tls", required_argument, 0, OPT_TLS},
+                                           {"tls-cert", required_argument, 0, OPT_TLS_CERT},
+                                           {"tls-key", required_argument, 0, OPT_TLS_KEY},
+                                           {"coalesce", no_argument, 0, OPT_COALESCE},
+                                           {"latency", no_argument, 0, OPT_LATENCY},
+                                           {"help", no_argument, 0, 'h'},
+                                           {0, 0, 0, 0}};
+
+    int opt;
+    while ((opt = getopt_long(argc, argv, "t:b:e:B:S:z:F:h", long_options, NULL)) != -1) {
+        switch (opt) {
+        case 't':
+            g_worker_count = atoi(optarg);
+            break;
+        case 'b':
+            if (parse_backend(optarg, &g_config.backend) < 0) {
+                fprintf(stderr, "错误: 未知的后端 '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'e':
+            if (parse_echo_mode(optarg, &g_config.echo_mode) < 0) {
+                fprintf(stderr, "错误: 未知的回显模式 '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case 'B': {
+            int entries = atoi(optarg);
+            if (entries <= 0 || entries > MAX_BUF_RING_ENTRIES || (entries & (entries - 1)) != 0) {
+                fprintf(stderr, "错误: buffer 数必须是 1-%d 之间的 2 的幂\n", MAX_BUF_RING_ENTRIES);
+                return 1;
+            }
+            g_config.buf_ring_entries = entries;
+            break;
+        }
+        case 'S': {
+            int size = atoi(optarg);
+            if (size <= 0 || size > MAX_BUFFER_SIZE) {
+                fprintf(stderr, "错误: 缓冲区大小必须在 1-%d 字节之间\n", MAX_BUFFER_SIZE);
+                return 1;
+            }
+            g_config.buf_size = size;
+            break;
+        }
+        case 'z':
+            if (strcmp(optarg, "auto") == 0) {
+                g_config.zc_auto = 1;
+            } else {
+                int threshold = atoi(optarg);
+                if (threshold < 0) {
+                    fprintf(stderr, "错误: 零拷贝阈值必须 >= 0\n");
+                    return 1;
+                }
+                g_config.zc_threshold = threshold;
+            }
+            break;
+        case 'F': {
+            int slots = atoi(optarg);
+            if (slots < 0) {
+                fprintf(stderr, "错误: fixed file 槽位数必须 >= 0\n");
+                return 1;
+            }
+            g_config.fixed_files = slots;
+            break;
+        }
+        case OPT_SQPOLL:
+            g_config.sqpoll = 1;
+            break;
+        case OPT_SQPOLL_CPUS:
+            g_config.sqpoll_cpu_count = topology_parse_cpu_list(optarg, &g_config.sqpoll_cpus);
+            if (g_config.sqpoll_cpu_count <= 0) {
+                fprintf(stderr, "错误: 无效的 CPU 列表 '%s'\n", optarg);
+                return 1;
+            }
+            g_config.sqpoll = 1;
+            break;
+        case OPT_CLIENT_CPUS:
+            g_config.client_cpu_count = topology_parse_cpu_list(optarg, &g_config.client_cpus);
+            if (g_config.client_cpu_count <= 0) {
+                fprintf(stderr, "错误: 无效的 CPU 列表 '%s'\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_NUMA_NIC:
+            snprintf(g_config.numa_nic, sizeof(g_config.numa_nic), "%s", optarg);
+            break;
+        case OPT_MIGRATE:
+            g_config.migrate = 1;
+            break;
+        case OPT_MIGRATE_THRESHOLD: {
+            int pct = atoi(optarg);
+            if (pct <= 0 || pct >= 100) {
+                fprintf(stderr, "错误: migrate-threshold 必须在 1-99 之间\n");
+                return 1;
+            }
+            g_config.migrate_threshold = pct;
+            break;
+        }
+        case OPT_MIGRATE_INTERVAL: {
+            int ms = atoi(optarg);
+            if (ms <= 0) {
+                fprintf(stderr, "错误: migrate-interval 必须 > 0\n");
+                return 1;
+            }
+            g_config.migrate_interval_ms = ms;
+            break;
+        }
+        case OPT_IDLE_TIMEOUT:
+        case OPT_WRITE_TIMEOUT: {
+            int ms = atoi(optarg);
+            if (ms < 0) {
+                fprintf(stderr, "错误: %s 不能为负数\n", opt == OPT_IDLE_TIMEOUT ? "idle-timeout" : "write-timeout");
+                return 1;
+            }
+            if (opt == OPT_IDLE_TIMEOUT)
+                g_config.idle_timeout_ms = ms;
+            else
+                g_config.write_timeout_ms = ms;
+            break;
+        }
+        case OPT_UDP:
+            g_config.udp = 1;
+            break;
+        case OPT_UDP_GSO:
+            g_config.udp = 1;
+            g_config.udp_gso = 1;
+            break;
+        case OPT_UDP_GRO:
+            // 合并交付的数据报必须按原段长发回，GRO 总是配合 GSO 使用
+            g_config.udp = 1;
+            g_config.udp_gso = 1;
+            g_config.udp_gro = 1;
+            break;
+        case OPT_UNIX: {
+            struct sockaddr_un addr;
+            if (unix_sockaddr(optarg, &addr) == 0) {
+                fprintf(stderr, "错误: Unix 域 socket 路径长度必须在 1-%zu 之间\n", sizeof(addr.sun_path) - 1);
+                return 1;
+            }
+            g_config.unix_path = optarg;
+            break;
+        }
+        case OPT_TLS:
+            if (strcmp(optarg, "ktls") == 0) {
+                g_config.tls = TLS_MODE_KTLS;
+            } else if (strcmp(optarg, "user") == 0) {
+                g_config.tls = TLS_MODE_USER;
+            } else {
+                fprintf(stderr, "错误: 未知的 TLS 模式 '%s' (ktls 或 user)\n", optarg);
+                return 1;
+            }
+            break;
+        case OPT_TLS_CERT:
+            g_config.tls_cert = optarg;
+            break;
+        case OPT_TLS_KEY:
+            g_config.tls_key = optarg;
+            break;
+        case OPT_SQPOLL_IDLE: {
+            int idle = atoi(optarg);
+            if (idle <= 0) {
+                fprintf(stderr, "错误: SQPOLL 空闲时间必须 > 0\n");
+                return 1;
+            }
+            g_config.sqpoll_idle_ms = idle;
+            break;
+        }
+        case OPT_DEFER_TASKRUN:
+            g_config.defer_taskrun = 1;
+            break;
+        case OPT_MIN_BATCH: {
+            int batch = atoi(optarg);
+            if (batch <= 0 || batch > QUEUE_DEPTH) {
+                fprintf(stderr, "错误: min-batch 必须在 1-%d 之间\n", QUEUE_DEPTH);
+                return 1;
+            }
+            g_config.min_batch = batch;
+            break;
+        }
+        case OPT_BATCH_WAIT: {
+            int wait_us = atoi(optarg);
+            if (wait_us <= 0 || wait_us >= 1000000) {
+                fprintf(stderr, "错误: batch-wait 必须在 1-999999 微秒之间\n");
+                return 1;
+            }
+            g_config.batch_wait_us = wait_us;
+            break;
+        }
+        case OPT_LINK_DEPTH: {
+            int depth = atoi(optarg);
+            if (depth <= 0 || depth > MAX_LINK_DEPTH) {
+                fprintf(stderr, "错误: link-depth 必须在 1-%d 之间\n", MAX_LINK_DEPTH);
+                return 1;
+            }
+            g_config.link_depth = depth;
+            break;
+        }
+        case OPT_PIPELINE_DEPTH: {
+            int depth = atoi(optarg);
+            if (depth <= 0 || depth > MAX_PIPELINE_DEPTH) {
+                fprintf(stderr, "错误: pipeline-depth 必须在 1-%d 之间\n", MAX_PIPELINE_DEPTH);
+                return 1;
+            }
+            g_config.pipeline_depth = depth;
+            break;
+        }
+        case OPT_MAX_MSG: {
+            long bytes = atol(optarg);
+            if (bytes <= 0 || bytes > MAX_MAX_MSG) {
+                fprintf(stderr, "错误: max-msg 必须在 1-%d 之间\n", MAX_MAX_MSG);
+                return 1;
+            }
+            g_config.max_msg = bytes;
+            break;
+        }
+        case OPT_RCVBUF:
+        case OPT_SNDBUF: {
+            int bytes = atoi(optarg);
+            if (bytes < 0) {
+                fprintf(stderr, "错误: socket 缓冲区大小必须 >= 0\n");
+                return 1;
+            }
+            if (opt == OPT_RCVBUF)
+                g_config.rcvbuf = bytes;
+            else
+                g_config.sndbuf = bytes;
+            break;
+        }
+        case OPT_PIPE_POOL: {
+            int pipes = atoi(optarg);
+            if (pipes < 0) {
+                fprintf(stderr, "错误: pipe 池大小必须 >= 0\n");
+                return 1;
+            }
+            g_config.pipe_pool = pipes;
+            break;
+        }
+        case OPT_SLAB: {
+            int objects = atoi(optarg);
+            if (objects < 0) {
+                fprintf(stderr, "错误: 对象池大小必须 >= 0\n");
+                return 1;
+            }
+            g_config.slab_objects = objects;
+            break;
+        }
+        case OPT_SLAB_HUGEPAGES:
+            g_config.slab_hugepages = 1;
+            break;
+        case OPT_BUSY_POLL:
+        case OPT_SPIN: {
+            int us = atoi(optarg);
+            if (us < 0 || us > MAX_BUSY_POLL_US) {
+                fprintf(stderr, "错误: %s 必须在 0-%d 微秒之间\n", opt == OPT_SPIN ? "spin" : "busy-poll",
+                        MAX_BUSY_POLL_US);
+                return 1;
+            }
+            if (opt == OPT_SPIN)
+                g_config.spin_us = us;
+            else
+                g_config.busy_poll_us = us;
+            break;
+        }
+        case OPT_BUSY_POLL_BUDGET: {
+            int budget = atoi(optarg);
+            if (budget < 0 || budget > 65535) {
+                fprintf(stderr, "错误: busy-poll-budget 必须在 0-65535 之间\n");
+                return 1;
+            }
+            g_config.busy_poll_budget = budget;
+            break;
+        }
+        case OPT_PREFER_BUSY_POLL:
+            g_config.prefer_busy_poll = 1;
+            break;
+        case OPT_COALESCE:
+            g_config.coalesce = 1;
+            break;
+        case OPT_LATENCY:
+            g_config.latency = 1;
+            break;
+        case OPT_REUSEPORT_LB:
+            g_config.reuseport_lb = 1;
+            break;
+        case OPT_PREFER_SYN_CPU: {
+            int slack = atoi(optarg);
+            if (slack < 0) {
+                fprintf(stderr, "错误: prefer-syn-cpu 的负载容差必须 >= 0\n");
+                return 1;
+            }
+            g_config.reuseport_lb = 1;
+            g_config.prefer_syn_cpu = 1;
+            g_config.syn_cpu_slack = slack;
+            break;
+        }
+        case 'h':
+            print_usage(argv[0]);
+            return 0;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    // 兼容旧用法: server [线程数]
+    if (optind < argc)
+        g_worker_count = atoi(argv[optind]);
+
+    if ((g_config.busy_poll_budget || g_config.prefer_busy_poll) && !g_config.busy_poll_us) {
+        fprintf(stderr, "错误: --busy-poll-budget/--prefer-busy-poll 需要同时指定 --busy-poll\n");
+        return 1;
+    }
+
+    // DEFER_TASKRUN 要求由创建 ring 的线程自己进入内核执行 task_work，与 SQPOLL 不兼容
+    if (g_config.defer_taskrun && g_config.sqpoll) {
+        fprintf(stderr, "错误: --defer-taskrun 不能与 --sqpoll 同时使用\n");
+        return 1;
+    }
+
     const char *log_dir = "test/logs";
     if (ensure_directory_exists(log_dir) != 0) {
         fprintf(stderr, "无法创建日志目录 %s: %s\n", log_dir, strerror(errno));
@@ -418,6 +4636,8 @@ int main(int argc, char *argv[]) {
 
     g_monitor = monitor_init();
     g_start_time_us = monitor_get_time_us();
+    monitor_get_tcp_segments(&g_start_segs[0], &g_start_segs[1]);
+    g_start_softirqs = monitor_get_net_softirqs();
 
     struct sigaction sa;
     sa.sa_handler = signal_handler;
@@ -428,20 +4648,284 @@ int main(int argc, char *argv[]) {
     signal(SIGPIPE, SIG_IGN);
 
     int num_cpus = monitor_get_cpu_count();
-    if (argc > 1)
-        g_worker_count = atoi(argv[1]);
     if (g_worker_count <= 0)
         g_worker_count = num_cpus;
 
-    LOG_INFO(g_logger, "启动 io_uring 服务器 | CPU: %d | Workers: %d | Port: %d", num_cpus, g_worker_count, PORT);
+    if (g_config.backend == BACKEND_IO_URING && !uring_available()) {
+        LOG_WARN(g_logger, "io_uring 不可用 (被内核或 seccomp 禁用)，回退到 epoll 后端");
+        g_config.backend = BACKEND_EPOLL;
+    }
+    // epoll 后端只实现 classic 回显，io_uring 专有选项一律复位，避免 stats 中出现误导性的配置
+    if (g_config.backend == BACKEND_EPOLL) {
+        if (g_config.echo_mode != ECHO_CLASSIC || ZC_ENABLED() || g_config.fixed_files || g_config.sqpoll ||
+            g_config.defer_taskrun || g_config.spin_us || g_config.migrate)
+            LOG_WARN(g_logger, "epoll 后端忽略 -e/-z/-F/--sqpoll/--defer-taskrun/--spin/--migrate 等 io_uring 选项");
+        g_config.echo_mode = ECHO_CLASSIC;
+        g_config.zc_threshold = 0;
+        g_config.zc_auto = 0;
+        g_config.fixed_files = 0;
+        g_config.sqpoll = 0;
+        g_config.sqpoll_cpu_count = 0;
+        g_config.defer_taskrun = 0;
+        g_config.spin_us = 0;
+        g_config.migrate = 0;
+    }
+    // 迁移只在 classic 模式的写完时刻进行: 其他模式的连接随时挂着 multishot recv / 链 / 管道等在途操作
+    if (g_config.migrate && (g_config.echo_mode != ECHO_CLASSIC || g_worker_count < 2)) {
+        LOG_WARN(g_logger, "--migrate 需要 classic 模式且至少 2 个 Worker，已忽略");
+        g_config.migrate = 0;
+    }
+    // fixed file 表中的连接没有普通 fd，无法设置 socket 选项，只保留按批合并写出
+    if (g_config.coalesce && g_config.fixed_files)
+        LOG_WARN(g_logger, "--coalesce 与 -F 同时使用时不设置 TCP_NODELAY / TCP_QUICKACK");
+    // framed 模式在原处回显完整帧，单帧 (帧头 + 载荷) 必须能放进每连接的 buf_size 缓冲区
+    if (g_config.echo_mode == ECHO_FRAMED && g_config.buf_size <= FRAME_HEADER_SIZE) {
+        LOG_ERROR(g_logger, "framed 模式的缓冲区 (-S) 必须大于帧头 %u 字节", FRAME_HEADER_SIZE);
+        logger_close(g_logger);
+        return 1;
+    }
+    // 超时只覆盖每连接同一时刻至多一个在途请求的模式；其他模式的连接同时挂着多个读写，没有单一的计时状态
+    if (TIMEOUTS_ENABLED() && g_config.echo_mode != ECHO_CLASSIC && g_config.echo_mode != ECHO_SPARSE) {
+        LOG_WARN(g_logger, "--idle-timeout/--write-timeout 只支持 classic 与 sparse 模式，已忽略");
+        g_config.idle_timeout_ms = 0;
+        g_config.write_timeout_ms = 0;
+    }
+
+    if (g_config.sqpoll_cpu_count > 0 &&
+        cpu_set_nth(&g_config.sqpoll_cpus, g_config.sqpoll_cpu_count - 1) >= num_cpus) {
+        LOG_ERROR(g_logger, "SQPOLL CPU 列表超出在线 CPU 范围 (0-%d)", num_cpus - 1);
+        logger_close(g_logger);
+        return 1;
+    }
+
+    LOG_INFO(g_logger, "启动 %s 服务器 | CPU: %d | Workers: %d | Port: %d | Echo: %s",
+             BACKEND_NAMES[g_config.backend], num_cpus, g_worker_count, PORT, ECHO_MODE_NAMES[g_config.echo_mode]);
+    // linked: 链上的下一个 read 会立即复用同一块 buffer，而零拷贝发送要等通知 CQE 才能释放 buffer
+    // splice: 数据本来就不经过用户态缓冲区
+    // pipelined / stream: 合并写出的 writev 没有零拷贝版本
+    // framed: 写出的帧所在的缓冲区随后会被整理复用，不能等通知 CQE
+    if ((g_config.echo_mode == ECHO_LINKED || g_config.echo_mode == ECHO_SPLICE ||
+         g_config.echo_mode == ECHO_PIPELINED || g_config.echo_mode == ECHO_STREAM ||
+         g_config.echo_mode == ECHO_FRAMED) &&
+        ZC_ENABLED()) {
+        LOG_WARN(g_logger, "%s 模式不支持零拷贝发送，已忽略 -z", ECHO_MODE_NAMES[g_config.echo_mode]);
+        g_config.zc_threshold = 0;
+        g_config.zc_auto = 0;
+    }
+    // 零拷贝发送只有 TCP/UDP 实现，AF_UNIX 上的 SEND_ZC 返回 EOPNOTSUPP；两个监听 socket 共用同一套回显路径
+    if (g_config.unix_path && ZC_ENABLED()) {
+        LOG_WARN(g_logger, "Unix 域 socket 不支持零拷贝发送，已忽略 -z");
+        g_config.zc_threshold = 0;
+        g_config.zc_auto = 0;
+    }
+#ifdef ENABLE_TLS
+    if (g_config.tls) {
+        // kTLS 只能装在 TCP socket 上；user 模式的加解密嵌在 classic 模式的读写完成处理中
+        const char *err = NULL;
+        if (g_config.unix_path)
+            err = "--tls 不能与 --unix 同时使用";
+        else if (g_config.tls == TLS_MODE_USER &&
+                 (g_config.backend != BACKEND_IO_URING || g_config.echo_mode != ECHO_CLASSIC))
+            err = "--tls user 只支持 io_uring 后端的 classic 模式";
+        else if (g_config.tls == TLS_MODE_KTLS && !tls_session_ktls_available())
+            err = "内核没有 tls ULP (需要 CONFIG_TLS，尝试 modprobe tls)，可改用 --tls user";
+        if (err) {
+            LOG_ERROR(g_logger, "%s", err);
+            logger_close(g_logger);
+            return 1;
+        }
+        // 内核 TLS 发送路径不支持 MSG_ZEROCOPY；user 模式发出的是 buffer 中的密文，同样不走零拷贝
+        if (ZC_ENABLED()) {
+            LOG_WARN(g_logger, "TLS 模式不支持零拷贝发送，已忽略 -z");
+            g_config.zc_threshold = 0;
+            g_config.zc_auto = 0;
+        }
+        // 握手在真实 fd 上进行，accept 不能直接进 fixed file 表
+        if (g_config.fixed_files) {
+            LOG_WARN(g_logger, "TLS 握手需要真实 fd，已关闭 fixed file 模式");
+            g_config.fixed_files = 0;
+        }
+        // user 模式的会话状态在 Worker 的 SSL 对象里，不随 fd 移交
+        if (g_config.tls == TLS_MODE_USER && g_config.migrate) {
+            LOG_WARN(g_logger, "--tls user 不支持连接迁移，已忽略 --migrate");
+            g_config.migrate = 0;
+        }
+        g_tls_ctx = tls_session_server_ctx(g_config.tls_cert, g_config.tls_key, g_config.tls == TLS_MODE_KTLS);
+        if (!g_tls_ctx) {
+            LOG_ERROR(g_logger, "创建 TLS 上下文失败 (证书: %s)", g_config.tls_cert ? g_config.tls_cert : "临时自签名");
+            logger_close(g_logger);
+            return 1;
+        }
+        LOG_INFO(g_logger, "TLS 1.3 回显: %s 模式, 证书 %s", TLS_MODE_NAMES[g_config.tls],
+                 g_config.tls_cert ? g_config.tls_cert : "临时自签名 (P-256)");
+    }
+#else
+    if (g_config.tls) {
+        LOG_WARN(g_logger, "--tls 需要 TLS 版本 (make all-tls)，以明文回显");
+        g_config.tls = TLS_MODE_OFF;
+    }
+#endif
+    if (g_config.echo_mode == ECHO_LINKED)
+        LOG_INFO(g_logger, "linked 模式: 每条链 %u 对 read→send", g_config.link_depth);
+    if (g_config.echo_mode == ECHO_PIPELINED)
+        LOG_INFO(g_logger, "pipelined 模式: 每连接 %u 个读缓冲槽位", g_config.pipeline_depth);
+    if (g_config.rcvbuf || g_config.sndbuf)
+        LOG_INFO(g_logger, "监听 socket 缓冲区上限: SO_RCVBUF=%d SO_SNDBUF=%d (0 为内核默认)", g_config.rcvbuf,
+                 g_config.sndbuf);
+    if (g_config.busy_poll_us)
+        LOG_INFO(g_logger, "busy poll: %u us, budget %u, prefer %s", g_config.busy_poll_us, g_config.busy_poll_budget,
+                 g_config.prefer_busy_poll ? "on" : "off");
+    if (g_config.spin_us)
+        LOG_INFO(g_logger, "阻塞等待前自适应自旋: 最长 %u us", g_config.spin_us);
+    if (g_config.udp)
+        LOG_INFO(g_logger, "UDP 回显: 端口 %d, 每批 %d 条, GSO %s, GRO %s", PORT, UDP_BATCH,
+                 g_config.udp_gso ? "on" : "off", g_config.udp_gro ? "on" : "off");
+    if (TIMEOUTS_ENABLED())
+        LOG_INFO(g_logger, "连接超时: 空闲 %u ms, 写阻塞 %u ms (0 为不限)", g_config.idle_timeout_ms,
+                 g_config.write_timeout_ms);
+    if (g_config.migrate)
+        LOG_INFO(g_logger, "连接迁移: 每 %u ms 评估一次，负载偏离平均值 %u%% 时空闲 Worker 窃取连接",
+                 g_config.migrate_interval_ms, g_config.migrate_threshold);
+    if (g_config.coalesce && (g_config.echo_mode == ECHO_PIPELINED || g_config.echo_mode == ECHO_FRAMED))
+        LOG_INFO(g_logger, "写合并: 新连接 TCP_NODELAY，每批 CQE 每连接合并为一次写，按消息速率切换 TCP_QUICKACK");
+    else if (g_config.coalesce)
+        LOG_INFO(g_logger, "写合并: 新连接 TCP_NODELAY (按批合并写出仅支持 pipelined / framed 模式)");
+    if (g_config.latency)
+        LOG_INFO(g_logger, "延迟直方图: 服务时间 (classic / multishot 模式) 与事件循环每轮耗时，控制命令 latency 查看");
+    if (g_config.echo_mode == ECHO_FRAMED)
+        LOG_INFO(g_logger, "framed 模式: 帧头 %u 字节，单帧最大 %u 字节 (-S)", FRAME_HEADER_SIZE, g_config.buf_size);
+    if (g_config.echo_mode == ECHO_STREAM)
+        LOG_INFO(g_logger, "stream 模式: 每连接最多缓冲 %u 字节，块大小 %u 字节", g_config.max_msg, g_config.buf_size);
+    if (g_config.zc_auto)
+        LOG_INFO(g_logger, "零拷贝发送: auto (每 %d ms 交替 copy/zc)", ZC_PROBE_WINDOW_US / 1000);
+    else if (g_config.zc_threshold > 0)
+        LOG_INFO(g_logger, "零拷贝发送: >= %u 字节", g_config.zc_threshold);
 
 #ifdef ENABLE_EBPF
     g_sockmap = sockmap_loader_init(EBPF_OBJ_PATH);
     if (g_sockmap)
         LOG_INFO(g_logger, "eBPF Sockmap 加载成功");
+    // direct descriptor 没有进程 fd，无法加入 sockmap，回退为普通 fd
+    if (g_sockmap && g_config.fixed_files) {
+        LOG_WARN(g_logger, "sockmap 需要真实 fd，已关闭 fixed file 模式");
+        g_config.fixed_files = 0;
+    }
+    if (g_config.reuseport_lb) {
+        g_reuseport = reuseport_loader_init(REUSEPORT_OBJ_PATH, g_worker_count, g_config.prefer_syn_cpu,
+                                            g_config.syn_cpu_slack);
+        if (g_reuseport) {
+            LOG_INFO(g_logger, "eBPF reuseport 分派加载成功: 最低负载优先%s",
+                     g_config.prefer_syn_cpu ? "，SYN 所在 CPU 优先" : "");
+        } else {
+            LOG_WARN(g_logger, "eBPF reuseport 分派加载失败 (需要 root 与 Linux >= 5.5)，使用内核哈希分派");
+            g_config.reuseport_lb = 0;
+            g_config.prefer_syn_cpu = 0;
+        }
+    }
+#else
+    if (g_config.reuseport_lb) {
+        LOG_WARN(g_logger, "--reuseport-lb/--prefer-syn-cpu 需要 eBPF 版本 (make all-ebpf)，使用内核哈希分派");
+        g_config.reuseport_lb = 0;
+        g_config.prefer_syn_cpu = 0;
+    }
 #endif
 
-    g_workers = calloc(g_worker_count, sizeof(WorkerContext));
+    if (g_config.fixed_files) {
+        // 注册的文件表大小受 RLIMIT_NOFILE 限制
+        struct rlimit rl;
+        if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur != RLIM_INFINITY &&
+            g_config.fixed_files > rl.rlim_cur) {
+            LOG_WARN(g_logger, "fixed file 槽位数 %u 超过 RLIMIT_NOFILE，调整为 %lu", g_config.fixed_files,
+                     (unsigned long)rl.rlim_cur);
+            g_config.fixed_files = rl.rlim_cur;
+        }
+        LOG_INFO(g_logger, "fixed file 模式: 每个 ring %u 个槽位", g_config.fixed_files);
+    }
+
+    // Worker 放置: 每个物理核一个，物理核用完才用 SMT 兄弟，避开 SQPOLL 与 client 保留的 CPU
+    if (topology_detect(&g_topology) < 0) {
+        LOG_ERROR(g_logger, "读取 CPU 拓扑失败");
+        logger_close(g_logger);
+        return 1;
+    }
+    cpu_set_t reserved;
+    CPU_ZERO(&reserved);
+    if (g_config.sqpoll && g_config.sqpoll_cpu_count > 0)
+        CPU_OR(&reserved, &reserved, &g_config.sqpoll_cpus);
+    if (g_config.client_cpu_count > 0)
+        CPU_OR(&reserved, &reserved, &g_config.client_cpus);
+    int nic_node = -1;
+    if (g_config.numa_nic[0]) {
+        nic_node = topology_nic_node(g_config.numa_nic);
+        if (nic_node < 0)
+            LOG_WARN(g_logger, "无法确定网卡 %s 所在的 NUMA 节点，Worker 在各节点间轮流分配", g_config.numa_nic);
+    }
+    int *worker_cpus = malloc(g_worker_count * sizeof(int));
+    if (!worker_cpus) {
+        LOG_ERROR(g_logger, "分配 Worker 放置表失败");
+        logger_close(g_logger);
+        return 1;
+    }
+    int avail = topology_plan(&g_topology, &reserved, nic_node, g_worker_count, worker_cpus);
+    if (avail == 0) {
+        LOG_WARN(g_logger, "所有在线 CPU 都已保留给 SQPOLL / client，忽略保留列表");
+        avail = topology_plan(&g_topology, NULL, nic_node, g_worker_count, worker_cpus);
+        g_config.client_cpu_count = 0;
+    }
+    LOG_INFO(g_logger, "CPU 拓扑: %d 个 NUMA 节点, %d 个物理核, %d 个逻辑 CPU; Worker 可用 %d 个", g_topology.nr_nodes,
+             g_topology.nr_cores, g_topology.nr_cpus, avail);
+    if (g_worker_count > avail)
+        LOG_WARN(g_logger, "Worker 数 %d 超过可用 CPU 数 %d，部分 CPU 由多个 Worker 共享", g_worker_count, avail);
+
+    size_t workers_size = g_worker_count * sizeof(WorkerContext);
+    g_workers = mmap(NULL, workers_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (g_workers == MAP_FAILED) {
+        LOG_ERROR(g_logger, "分配 Worker 上下文失败: %s", strerror(errno));
+        free(worker_cpus);
+        logger_close(g_logger);
+        return 1;
+    }
+    // 先绑定全部上下文再写入任何字段: MPOL_PREFERRED 不迁移已经分配的页，主线程的首次写入会把上下文首页
+    // (ring、ThreadStats 所在的最热数据) 留在主线程所在节点
+    if (g_topology.nr_nodes > 1) {
+        for (int i = 0; i < g_worker_count; i++) {
+            const TopoCpu *c = topology_cpu(&g_topology, worker_cpus[i]);
+            int err = topology_bind_memory(&g_workers[i], sizeof(WorkerContext), c ? c->node : 0);
+            if (err < 0)
+                LOG_WARN(g_logger, "Worker %d 上下文绑定到节点 %d 失败: %s", i, c ? c->node : 0, strerror(-err));
+        }
+    }
+    for (int i = 0; i < g_worker_count; i++) {
+        const TopoCpu *c = topology_cpu(&g_topology, worker_cpus[i]);
+        g_workers[i].cpu = worker_cpus[i];
+        g_workers[i].node = c ? c->node : 0;
+        LOG_INFO(g_logger, "放置: Worker %d → CPU %d (节点 %d, socket %d, 物理核 %d%s)", i, worker_cpus[i],
+                 g_workers[i].node, c ? c->package : 0, c ? c->core : worker_cpus[i],
+                 c && c->thread > 0 ? ", SMT 兄弟" : "");
+    }
+    free(worker_cpus);
+    if (g_config.client_cpu_count > 0) {
+        char list[256] = "";
+        int off = 0;
+        for (int cpu = 0; cpu < CPU_SETSIZE && off < (int)sizeof(list) - 8; cpu++) {
+            if (CPU_ISSET(cpu, &g_config.client_cpus))
+                off += snprintf(list + off, sizeof(list) - off, "%s%d", off ? "," : "", cpu);
+        }
+        LOG_INFO(g_logger, "保留给 client 的 CPU: %s (taskset -c %s ./out/client ...)", list, list);
+    }
+
+    if (g_config.unix_path) {
+        g_unix_listen_fd = create_unix_listener(g_config.unix_path);
+        if (g_unix_listen_fd < 0) {
+            LOG_ERROR(g_logger, "创建 Unix 域监听 Socket %s 失败: %s", g_config.unix_path, strerror(errno));
+            munmap(g_workers, workers_size);
+            logger_close(g_logger);
+            return 1;
+        }
+        LOG_INFO(g_logger, "Unix 域 socket 回显: %s%s", g_config.unix_path,
+                 g_config.unix_path[0] == '@' ? " (抽象命名空间)" : "");
+    }
+
     for (int i = 0; i < g_worker_count; i++) {
         g_workers[i].thread_id = i;
         if (pthread_create(&g_workers[i].thread_handle, NULL, worker_routine, &g_workers[i]) != 0) {
@@ -458,11 +4942,31 @@ int main(int argc, char *argv[]) {
         pthread_join(g_workers[i].thread_handle, NULL);
     }
 
+    if (ZC_ENABLED()) {
+        ZcStats total;
+        long long crossover = zc_crossover(&total);
+        if (crossover > 0)
+            LOG_INFO(g_logger, "零拷贝交叉点: >= %lld 字节时 SEND_ZC 每字节 CPU 开销低于拷贝", crossover);
+        else
+            LOG_INFO(g_logger, "零拷贝交叉点: 样本不足或零拷贝在所有分档均未胜出");
+    }
+
+    if (g_unix_listen_fd >= 0) {
+        close(g_unix_listen_fd);
+        if (g_config.unix_path[0] != '@')
+            unlink(g_config.unix_path);
+    }
+
 #ifdef ENABLE_EBPF
+    if (g_reuseport)
+        reuseport_loader_destroy(g_reuseport);
     if (g_sockmap)
         sockmap_loader_destroy(g_sockmap);
 #endif
-    free(g_workers);
+#ifdef ENABLE_TLS
+    SSL_CTX_free(g_tls_ctx);
+#endif
+    munmap(g_workers, workers_size);
     monitor_destroy(g_monitor);
     logger_close(g_logger);
     return 0;
@@ -0,0 +1,71 @@
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+#include <string.h>
+#include <endian.h>
+
+// 长度前缀帧协议 (服务端 -e framed / 客户端 --framed)
+// 每帧 = 16 字节帧头 + len 字节载荷，帧头各字段均为网络字节序。服务端只看 len 来切分帧，
+// seq 与 sent_us 原样回显，客户端据此校验顺序并按帧计算往返延迟
+typedef struct {
+    uint32_t len;      // 载荷长度，不含帧头
+    uint32_t seq;      // 连接内的请求序号
+    uint64_t sent_us;  // 客户端发送时间 (monitor_get_time_us)
+} FrameHeader;
+
+#define FRAME_HEADER_SIZE ((unsigned)sizeof(FrameHeader))
+
+// 增量解析结果
+typedef struct {
+    unsigned bytes;      // 完整帧的总字节数 (从解析起点算起)
+    unsigned frames;     // 完整帧数
+    unsigned next_size;  // 第一个不完整帧的总长度 (帧头未收齐时为 FRAME_HEADER_SIZE)，没有剩余数据时为 0
+    long long sent_us;   // 完整帧中 sent_us 之和，用于统计客户端到服务端的时延
+} FrameScan;
+
+// ============================================
+// 函数声明
+// ============================================
+
+// 写帧头 (buf 不要求对齐)
+static inline void frame_header_write(void *buf, uint32_t len, uint32_t seq, long long sent_us) {
+    FrameHeader hdr = {htobe32(len), htobe32(seq), htobe64((uint64_t)sent_us)};
+    memcpy(buf, &hdr, sizeof(hdr));
+}
+
+// 读帧头，转换为主机字节序
+static inline void frame_header_read(const void *buf, FrameHeader *hdr) {
+    memcpy(hdr, buf, sizeof(*hdr));
+    hdr->len = be32toh(hdr->len);
+    hdr->seq = be32toh(hdr->seq);
+    hdr->sent_us = be64toh(hdr->sent_us);
+}
+
+// 从帧边界 buf 开始逐帧跳过，只读帧头不触碰载荷；调用方保留不完整的尾部，收到更多数据后从同一边界重新扫描
+// 单帧总长度超过 max_frame 时返回 -1 (协议错误)，否则返回 0
+static inline int frame_scan(const char *buf, unsigned len, unsigned max_frame, FrameScan *scan) {
+    scan->bytes = 0;
+    scan->frames = 0;
+    scan->next_size = 0;
+    scan->sent_us = 0;
+    while (len - scan->bytes >= FRAME_HEADER_SIZE) {
+        FrameHeader hdr;
+        frame_header_read(buf + scan->bytes, &hdr);
+        if (hdr.len > max_frame - FRAME_HEADER_SIZE)
+            return -1;
+        unsigned size = FRAME_HEADER_SIZE + hdr.len;
+        if (len - scan->bytes < size) {
+            scan->next_size = size;
+            return 0;
+        }
+        scan->bytes += size;
+        scan->frames++;
+        scan->sent_us += (long long)hdr.sent_us;
+    }
+    if (len > scan->bytes)
+        scan->next_size = FRAME_HEADER_SIZE;
+    return 0;
+}
+
+#endif // FRAME_H
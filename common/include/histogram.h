@@ -0,0 +1,49 @@
+#ifndef HISTOGRAM_H
+#define HISTOGRAM_H
+
+// HDR 风格的对数线性直方图 (单线程写入，每个 Worker 一个)
+// 值按最高位分组，每组 (一个 2 的幂区间) 再线性分为 HIST_SUB_COUNT 档，相对误差不超过 1/HIST_SUB_COUNT；
+// 小于 HIST_SUB_COUNT 的值每个单位一档。记录只是一次数组自增，不用原子操作：其他线程读取时
+// 可能看到个别计数尚未更新，对分位数统计无影响
+#define HIST_SUB_BITS 5
+#define HIST_SUB_COUNT (1 << HIST_SUB_BITS)                          // 每组 32 档，相对误差 < 3.2%
+#define HIST_MAX_BITS 40                                              // 覆盖 [0, 2^40)，按纳秒约 18 分钟
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_COUNT)  // 更大的值计入最后一档
+
+typedef struct {
+    unsigned long long counts[HIST_BUCKETS];
+    unsigned long long total;  // 样本数
+    unsigned long long sum;    // 样本之和，用于均值
+    unsigned long long max;    // 精确最大值
+} Histogram;
+
+// ============================================
+// 函数声明
+// ============================================
+
+static inline unsigned histogram_bucket(unsigned long long value) {
+    if (value < HIST_SUB_COUNT)
+        return (unsigned)value;
+    unsigned shift = 63 - __builtin_clzll(value) - HIST_SUB_BITS;
+    if (shift > HIST_MAX_BITS - HIST_SUB_BITS - 1)
+        return HIST_BUCKETS - 1;
+    return (shift + 1) * HIST_SUB_COUNT + (unsigned)(value >> shift) - HIST_SUB_COUNT;
+}
+
+// 记录一个样本 (负值按 0 计)
+static inline void histogram_record(Histogram *hist, long long value) {
+    unsigned long long v = value > 0 ? (unsigned long long)value : 0;
+    hist->counts[histogram_bucket(v)]++;
+    hist->total++;
+    hist->sum += v;
+    if (v > hist->max)
+        hist->max = v;
+}
+
+// 把 src 累加到 dst (dst 由调用方清零)
+void histogram_merge(Histogram *dst, const Histogram *src);
+
+// 分位数 q (0-1): 返回样本所在档的上界，不超过最大值；没有样本时返回 0
+unsigned long long histogram_percentile(const Histogram *hist, double q);
+
+#endif // HISTOGRAM_H
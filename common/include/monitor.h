@@ -65,7 +65,22 @@ void monitor_destroy(Monitor *monitor);
 // 获取当前时间（微秒）
 long long monitor_get_time_us();
 
+// 获取单调时钟（纳秒），用于测量时间间隔
+long long monitor_get_time_ns();
+
 // 获取系统 CPU 核心数
 int monitor_get_cpu_count();
 
+// 获取调用线程已消耗的 CPU 时间（纳秒，含内核态）
+long long monitor_get_thread_cpu_ns();
+
+// 从 /proc/net/sockstat 读取系统 TCP socket 数与 socket 缓冲区占用（页）
+int monitor_get_tcp_sockstat(long *inuse, long *mem_pages);
+
+// 从 /proc/net/snmp 读取系统累计收发的 TCP 段数
+int monitor_get_tcp_segments(long long *in_segs, long long *out_segs);
+
+// 从 /proc/softirqs 读取所有 CPU 累计的 NET_RX + NET_TX 软中断次数，失败返回 -1
+long long monitor_get_net_softirqs();
+
 #endif // MONITOR_H
@@ -0,0 +1,46 @@
+#ifndef SEQLOCK_H
+#define SEQLOCK_H
+
+#include <stddef.h>
+
+// 单写者顺序锁: 写者更新前后各把序号加一 (更新期间为奇数)，读者复制数据前后序号一致且为偶数才算拿到一致的快照，
+// 否则重试。写者从不等待读者，适合 Worker 发布统计、控制线程偶尔读取的场景。
+// 受保护的数据按 long long 逐字以 relaxed 原子操作读写 (seqlock_copy)，不构成数据竞争
+typedef struct {
+    unsigned seq;
+} SeqLock;
+
+// ============================================
+// 函数声明
+// ============================================
+
+static inline void seqlock_write_begin(SeqLock *lock) {
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);  // 奇数序号先于数据可见
+}
+
+static inline void seqlock_write_end(SeqLock *lock) {
+    __atomic_store_n(&lock->seq, lock->seq + 1, __ATOMIC_RELEASE);
+}
+
+// 返回开始读取时的序号 (写者正在更新时自旋等待，更新只是一次几百字节的复制)
+static inline unsigned seqlock_read_begin(const SeqLock *lock) {
+    unsigned seq;
+    while ((seq = __atomic_load_n(&lock->seq, __ATOMIC_ACQUIRE)) & 1)
+        ;
+    return seq;
+}
+
+// 读取期间有写入时返回非 0，调用方应重新读取
+static inline int seqlock_read_retry(const SeqLock *lock, unsigned seq) {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);  // 数据读取先于再次检查序号
+    return __atomic_load_n(&lock->seq, __ATOMIC_RELAXED) != seq;
+}
+
+// 逐字复制 words 个 long long，写者发布与读者取快照共用
+static inline void seqlock_copy(long long *dst, const long long *src, size_t words) {
+    for (size_t i = 0; i < words; i++)
+        __atomic_store_n(&dst[i], __atomic_load_n(&src[i], __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+}
+
+#endif // SEQLOCK_H
@@ -0,0 +1,50 @@
+#ifndef SLAB_POOL_H
+#define SLAB_POOL_H
+
+#include <stddef.h>
+
+#define SLAB_CACHE_LINE 64
+#define SLAB_HUGE_PAGE_SIZE (2UL * 1024 * 1024)
+
+// 对象池底层内存类型
+typedef enum {
+    SLAB_PAGES_NORMAL,   // 普通 4KB 页
+    SLAB_PAGES_THP,      // 透明大页 (madvise(MADV_HUGEPAGE)，由内核尽力合并)
+    SLAB_PAGES_HUGETLB,  // 预留的 2MB hugetlb 页 (MAP_HUGETLB)
+} SlabPageType;
+
+// 定长对象池（单线程使用，每个 Worker 一个）
+// 启动时一次性映射并预先触碰全部内存，之后分配/释放只操作侵入式空闲链表
+typedef struct {
+    char *base;                  // 对象区域起始地址
+    size_t region_size;          // 映射大小（按页或 2MB 向上取整）
+    size_t obj_size;             // 按缓存行对齐后的对象大小
+    size_t capacity;             // 区域内可容纳的对象数
+    void *free_list;             // 空闲对象单链表，对象首 8 字节存放 next 指针
+    size_t in_use;               // 当前已分配的对象数（含回退到 malloc 的对象）
+    size_t high_water;           // in_use 的历史最大值
+    long long fallback_allocs;   // 池耗尽后回退到 malloc 的次数
+    SlabPageType page_type;
+} SlabPool;
+
+// ============================================
+// 函数声明
+// ============================================
+
+// 初始化对象池；use_hugepages 时优先使用 hugetlb 页，失败则退回透明大页
+// 成功返回 0，失败返回 -errno
+int slab_pool_init(SlabPool *pool, size_t obj_size, size_t capacity, int use_hugepages);
+
+// 分配一个对象（缓存行对齐）；池耗尽时回退到 malloc
+void* slab_alloc(SlabPool *pool);
+
+// 释放对象
+void slab_free(SlabPool *pool, void *obj);
+
+// 释放对象池的全部内存
+void slab_pool_destroy(SlabPool *pool);
+
+// 内存类型名称（用于日志与 stats）
+const char* slab_page_type_name(SlabPageType type);
+
+#endif // SLAB_POOL_H
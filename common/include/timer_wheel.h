@@ -0,0 +1,58 @@
+#ifndef TIMER_WHEEL_H
+#define TIMER_WHEEL_H
+
+#include <stddef.h>
+
+// 侵入式定时器节点，嵌入在连接上下文中；prev 为 NULL 表示未挂在时间轮上
+typedef struct TimerNode {
+    struct TimerNode *prev;
+    struct TimerNode *next;
+    long long expires;    // 到期 tick
+    long long slot_tick;  // 节点当前所在槽位对应的 tick (>= expires 之前的某个值)
+} TimerNode;
+
+// 哈希时间轮（单线程使用，每个 Worker 一个）
+// 到期时间按 tick 取模散列到槽位，超过一圈的定时器在槽位中等待后续轮次。
+// 推迟到期时间只改 expires，节点留在原槽位，轮到时再按新的到期时间重新挂入 (惰性重排)，
+// 因此每次 I/O 刷新超时只是一次赋值
+typedef struct {
+    TimerNode *slots;     // nr_slots 个哨兵节点组成的双向循环链表头
+    unsigned nr_slots;    // 2 的幂
+    unsigned tick_us;     // 每个 tick 的时长
+    long long now_tick;   // 已推进到的 tick
+    size_t armed;         // 挂在时间轮上的节点数
+} TimerWheel;
+
+// ============================================
+// 函数声明
+// ============================================
+
+// 初始化时间轮；nr_slots 向上取整为 2 的幂，now_us 为起始时间 (微秒)
+// 成功返回 0，失败返回 -1
+int timer_wheel_init(TimerWheel *wheel, unsigned nr_slots, unsigned tick_us, long long now_us);
+
+// 初始化节点 (未挂在时间轮上)
+static inline void timer_node_init(TimerNode *node) {
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+static inline int timer_node_armed(const TimerNode *node) {
+    return node->prev != NULL;
+}
+
+// 设置节点在 expires_us (绝对时间，微秒) 到期，早于已推进到的时间时在下一个 tick 到期；已挂上的节点会被改期
+void timer_wheel_arm(TimerWheel *wheel, TimerNode *node, long long expires_us);
+
+// 从时间轮上摘下节点，未挂上时为空操作
+void timer_wheel_cancel(TimerWheel *wheel, TimerNode *node);
+
+// 推进到 now_us，对每个到期节点先摘下再调用 expire(node, arg)；回调中可以重新 arm 或释放该节点，
+// 但不能 cancel 其他节点 (它们可能正处在被扫描的槽位中)
+// 返回到期的节点数
+int timer_wheel_advance(TimerWheel *wheel, long long now_us, void (*expire)(TimerNode *node, void *arg), void *arg);
+
+// 释放槽位数组 (不触碰仍挂着的节点)
+void timer_wheel_destroy(TimerWheel *wheel);
+
+#endif // TIMER_WHEEL_H
@@ -0,0 +1,47 @@
+#ifndef TLS_SESSION_H
+#define TLS_SESSION_H
+
+#include <openssl/ssl.h>
+
+#define TLS_HANDSHAKE_TIMEOUT_MS 5000  // 单个连接握手的最长时间 (服务端由 Worker 的时间轮计时)
+
+// TLS 1.3 会话建立与 kTLS 安装 (server_tls / client_tls 共用，需要 OpenSSL >= 3.0)
+// 握手在用户态完成，之后从握手过程导出的流量密钥派生 key/iv，用 setsockopt(SOL_TLS, TLS_TX/TLS_RX)
+// 交给内核，socket 上的普通 read/write 即收发明文。只协商内核支持的 AES-GCM 套件，服务端不发会话票据，
+// 因此两个方向的应用数据记录序号都从 0 开始
+
+// ============================================
+// 函数声明
+// ============================================
+
+// 服务端 SSL_CTX: cert/key 为 NULL 时生成一张临时的 P-256 自签名证书
+// ktls 非 0 时记录流量密钥供 tls_session_install_ktls 使用
+// 失败返回 NULL
+SSL_CTX* tls_session_server_ctx(const char *cert, const char *key, int ktls);
+
+// 客户端 SSL_CTX: 压测场景不校验证书
+SSL_CTX* tls_session_client_ctx(int ktls);
+
+// 创建绑定到 fd 的 SSL (socket BIO 不负责关闭 fd)，处于服务端 / 客户端握手状态，失败返回 NULL
+SSL* tls_session_new(SSL_CTX *ctx, int fd, int is_server);
+
+// 非阻塞推进一次握手 (fd 须为非阻塞): 完成返回 0，需要等待 socket 就绪时返回要等待的 poll 事件
+// (POLLIN / POLLOUT，与 EPOLLIN / EPOLLOUT 数值相同)，失败返回 -1。由调用方的事件循环在就绪后再次调用
+int tls_session_handshake_step(SSL *ssl);
+
+// 在 fd 上完成握手 (阻塞或非阻塞 fd 均可，等待时 poll)，超过 timeout_ms 视为失败
+// 成功返回 SSL 对象 (socket BIO 不负责关闭 fd)，失败返回 NULL
+SSL* tls_session_handshake(SSL_CTX *ctx, int fd, int is_server, int timeout_ms);
+
+// 把握手后的会话密钥装入内核 (TCP_ULP "tls" + TLS_TX/TLS_RX)，之后可以直接 SSL_free
+// 成功返回 0，失败返回 -errno (SSL 中还有未处理的数据时返回 -EPROTO)
+int tls_session_install_ktls(SSL *ssl, int fd, int is_server);
+
+// 握手后改用一对内存 BIO: 密文由调用方自己收发 (如 io_uring)，SSL 只负责加解密
+// 成功返回 0，失败返回 -1
+int tls_session_use_memory_bio(SSL *ssl);
+
+// 内核是否提供 tls ULP (未连接的 socket 上设置 TCP_ULP 返回 ENOTCONN 说明可用，ENOENT 说明没有 tls 模块)
+int tls_session_ktls_available(void);
+
+#endif // TLS_SESSION_H
@@ -0,0 +1,61 @@
+#ifndef TOPOLOGY_H
+#define TOPOLOGY_H
+
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <sched.h>
+#include <stddef.h>
+
+#define TOPO_MAX_CPUS 1024
+#define TOPO_MAX_NODES 64
+
+// 单个在线 CPU 的拓扑位置
+typedef struct {
+    int cpu;      // 逻辑 CPU 编号
+    int node;     // NUMA 节点
+    int package;  // 物理封装 (socket)
+    int core;     // 封装内的物理核编号
+    int thread;   // 在同一物理核的 SMT 兄弟中的序号，0 为第一个线程
+} TopoCpu;
+
+// 从 /sys/devices/system 读取的 CPU 拓扑
+typedef struct {
+    int nr_cpus;   // 在线 CPU 数
+    int nr_cores;  // 物理核数
+    int nr_nodes;  // NUMA 节点数 (内核未开启 NUMA 时为 1)
+    TopoCpu cpus[TOPO_MAX_CPUS];  // 按逻辑 CPU 编号升序
+} Topology;
+
+// ============================================
+// 函数声明
+// ============================================
+
+// 读取在线 CPU 的节点 / 封装 / 物理核 / SMT 信息；/sys 缺失时退化为每个 CPU 一个物理核、单节点
+// 成功返回 0，失败返回 -1
+int topology_detect(Topology *topo);
+
+// 生成 count 个 Worker 的 CPU 分配 (写入 cpus)：跳过 exclude 中的 CPU，先每个物理核一个，物理核用完再用 SMT 兄弟。
+// first_node >= 0 时先占满该节点 (如网卡所在节点)，否则在各节点间轮流分配
+// Worker 多于可用 CPU 时循环复用。返回可用 CPU 数，0 表示全部被排除
+int topology_plan(const Topology *topo, const cpu_set_t *exclude, int first_node, int count, int *cpus);
+
+// 逻辑 CPU 所在的拓扑项，不在线返回 NULL
+const TopoCpu* topology_cpu(const Topology *topo, int cpu);
+
+// 网卡所在的 NUMA 节点 (/sys/class/net/<ifname>/device/numa_node)，未知返回 -1
+int topology_nic_node(const char *ifname);
+
+// 调用线程之后的内存分配优先落在 node 上 (set_mempolicy(MPOL_PREFERRED))
+// 成功返回 0，失败返回 -errno
+int topology_prefer_node(int node);
+
+// 将一段页对齐的内存绑定到 node (mbind(MPOL_PREFERRED))，需在首次触碰之前调用
+// 成功返回 0，失败返回 -errno
+int topology_bind_memory(void *addr, size_t len, int node);
+
+// 解析 CPU 列表，格式同 taskset -c: "2,3,8-11"
+// 返回: CPU 个数，格式错误返回 -1
+int topology_parse_cpu_list(const char *list, cpu_set_t *set);
+
+#endif // TOPOLOGY_H
@@ -0,0 +1,41 @@
+#include "histogram.h"
+
+// 档 idx 覆盖的最大值
+static unsigned long long bucket_upper(unsigned idx) {
+    unsigned group = idx / HIST_SUB_COUNT;
+    unsigned long long sub = idx % HIST_SUB_COUNT;
+    if (group == 0)
+        return sub;
+    unsigned shift = group - 1;
+    return ((HIST_SUB_COUNT + sub + 1) << shift) - 1;
+}
+
+void histogram_merge(Histogram *dst, const Histogram *src) {
+    for (unsigned i = 0; i < HIST_BUCKETS; i++)
+        dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->max > dst->max)
+        dst->max = src->max;
+}
+
+unsigned long long histogram_percentile(const Histogram *hist, double q) {
+    // 按各档计数之和定位，不用 total: 并发读取时两者可能差几个样本
+    unsigned long long total = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++)
+        total += hist->counts[i];
+    if (total == 0)
+        return 0;
+    unsigned long long target = (unsigned long long)(q * total + 0.5);
+    if (target == 0)
+        target = 1;
+    unsigned long long seen = 0;
+    for (unsigned i = 0; i < HIST_BUCKETS; i++) {
+        seen += hist->counts[i];
+        if (seen >= target) {
+            unsigned long long upper = i == HIST_BUCKETS - 1 ? hist->max : bucket_upper(i);
+            return upper < hist->max ? upper : hist->max;
+        }
+    }
+    return hist->max;
+}
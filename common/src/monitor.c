@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <unistd.h>
+#include <time.h>
 #include <sys/time.h>
 #include <sys/resource.h>
 
@@ -26,11 +27,100 @@ long long monitor_get_time_us() {
     return tv.tv_sec * 1000000LL + tv.tv_usec;
 }
 
+// 获取单调时钟（纳秒）
+long long monitor_get_time_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
 // 获取系统 CPU 核心数
 int monitor_get_cpu_count() {
     return sysconf(_SC_NPROCESSORS_ONLN);
 }
 
+// 获取调用线程已消耗的 CPU 时间（纳秒，含内核态）
+long long monitor_get_thread_cpu_ns() {
+    struct timespec ts;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) < 0) {
+        return 0;
+    }
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// 从 /proc/net/sockstat 读取系统 TCP socket 数与 socket 缓冲区占用（页）
+// 格式: TCP: inuse 5 orphan 0 tw 0 alloc 7 mem 1
+int monitor_get_tcp_sockstat(long *inuse, long *mem_pages) {
+    FILE *fp = fopen("/proc/net/sockstat", "r");
+    if (!fp) {
+        return -1;
+    }
+
+    char line[256];
+    int ret = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "TCP: inuse %ld orphan %*d tw %*d alloc %*d mem %ld", inuse, mem_pages) == 2) {
+            ret = 0;
+            break;
+        }
+    }
+
+    fclose(fp);
+    return ret;
+}
+
+int monitor_get_tcp_segments(long long *in_segs, long long *out_segs) {
+    FILE *fp = fopen("/proc/net/snmp", "r");
+    if (!fp) {
+        return -1;
+    }
+
+    // Tcp: 有两行，第一行是字段名，第二行是数值；InSegs / OutSegs 为第 10、11 个字段
+    char line[512];
+    int ret = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        if (sscanf(line, "Tcp: %*d %*d %*d %*d %*d %*d %*d %*d %*d %lld %lld", in_segs, out_segs) == 2) {
+            ret = 0;
+            break;
+        }
+    }
+
+    fclose(fp);
+    return ret;
+}
+
+long long monitor_get_net_softirqs() {
+    FILE *fp = fopen("/proc/softirqs", "r");
+    if (!fp) {
+        return -1;
+    }
+
+    // 每行: 名称后跟每个 CPU 一列计数
+    char line[8192];
+    long long total = -1;
+    while (fgets(line, sizeof(line), fp)) {
+        char *p = line;
+        while (*p == ' ')
+            p++;
+        if (strncmp(p, "NET_RX:", 7) != 0 && strncmp(p, "NET_TX:", 7) != 0)
+            continue;
+        p += 7;
+        if (total < 0)
+            total = 0;
+        for (;;) {
+            char *end;
+            long long v = strtoll(p, &end, 10);
+            if (end == p)
+                break;
+            total += v;
+            p = end;
+        }
+    }
+
+    fclose(fp);
+    return total;
+}
+
 // 从 /proc/self/stat 读取 CPU 时间
 static int read_cpu_time(unsigned long *utime, unsigned long *stime) {
     FILE *fp = fopen("/proc/self/stat", "r");
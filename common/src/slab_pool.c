@@ -0,0 +1,146 @@
+#define _GNU_SOURCE
+#include "slab_pool.h"
+#include <stdlib.h>
+#include <stdint.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#ifndef MAP_HUGE_2MB
+#define MAP_HUGE_2MB (21 << 26)
+#endif
+
+static const char *PAGE_TYPE_NAMES[] = {"normal", "thp", "hugetlb"};
+
+static size_t round_up(size_t value, size_t align) {
+    return (value + align - 1) / align * align;
+}
+
+// 按 2MB 对齐映射一段匿名内存并建议内核使用透明大页
+static char* map_thp(size_t size) {
+    size_t span = size + SLAB_HUGE_PAGE_SIZE;
+    char *raw = mmap(NULL, span, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (raw == MAP_FAILED) {
+        return NULL;
+    }
+
+    char *aligned = (char*)round_up((uintptr_t)raw, SLAB_HUGE_PAGE_SIZE);
+    if (aligned > raw) {
+        munmap(raw, aligned - raw);
+    }
+    size_t tail = (raw + span) - (aligned + size);
+    if (tail > 0) {
+        munmap(aligned + size, tail);
+    }
+    madvise(aligned, size, MADV_HUGEPAGE);
+    return aligned;
+}
+
+// 初始化对象池
+int slab_pool_init(SlabPool *pool, size_t obj_size, size_t capacity, int use_hugepages) {
+    pool->base = NULL;
+    pool->free_list = NULL;
+    pool->in_use = 0;
+    pool->high_water = 0;
+    pool->fallback_allocs = 0;
+    pool->obj_size = round_up(obj_size < sizeof(void*) ? sizeof(void*) : obj_size, SLAB_CACHE_LINE);
+    pool->capacity = capacity;
+    pool->page_type = SLAB_PAGES_NORMAL;
+
+    if (capacity == 0) {
+        pool->region_size = 0;
+        return 0;
+    }
+
+    size_t page_size = sysconf(_SC_PAGESIZE);
+    char *base = NULL;
+    if (use_hugepages) {
+        pool->region_size = round_up(pool->obj_size * capacity, SLAB_HUGE_PAGE_SIZE);
+        base = mmap(NULL, pool->region_size, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_HUGE_2MB | MAP_POPULATE, -1, 0);
+        if (base != MAP_FAILED) {
+            pool->page_type = SLAB_PAGES_HUGETLB;
+        } else {
+            // 没有预留 hugetlb 页 (vm.nr_hugepages = 0) 时退回透明大页
+            base = map_thp(pool->region_size);
+            pool->page_type = SLAB_PAGES_THP;
+        }
+    } else {
+        pool->region_size = round_up(pool->obj_size * capacity, page_size);
+        base = mmap(NULL, pool->region_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_POPULATE,
+                    -1, 0);
+        if (base == MAP_FAILED) {
+            base = NULL;
+        }
+    }
+    if (!base) {
+        return -ENOMEM;
+    }
+
+    // 区域可能因取整容纳更多对象
+    pool->base = base;
+    pool->capacity = pool->region_size / pool->obj_size;
+
+    // 逐页触碰，启动时就完成缺页，之后 RSS 不再随连接数变化
+    for (size_t off = 0; off < pool->region_size; off += page_size) {
+        base[off] = 0;
+    }
+
+    // 倒序串起空闲链表，使分配顺序与地址顺序一致
+    for (size_t i = pool->capacity; i > 0; i--) {
+        void **obj = (void**)(base + (i - 1) * pool->obj_size);
+        *obj = pool->free_list;
+        pool->free_list = obj;
+    }
+    return 0;
+}
+
+// 分配一个对象
+void* slab_alloc(SlabPool *pool) {
+    void *obj = pool->free_list;
+    if (obj) {
+        pool->free_list = *(void**)obj;
+    } else {
+        if (posix_memalign(&obj, SLAB_CACHE_LINE, pool->obj_size) != 0) {
+            return NULL;
+        }
+        pool->fallback_allocs++;
+    }
+
+    pool->in_use++;
+    if (pool->in_use > pool->high_water) {
+        pool->high_water = pool->in_use;
+    }
+    return obj;
+}
+
+// 释放对象：池内对象放回空闲链表，回退分配的对象交还 malloc
+void slab_free(SlabPool *pool, void *obj) {
+    if (!obj) {
+        return;
+    }
+
+    pool->in_use--;
+    char *p = (char*)obj;
+    if (p >= pool->base && p < pool->base + pool->capacity * pool->obj_size) {
+        *(void**)obj = pool->free_list;
+        pool->free_list = obj;
+    } else {
+        free(obj);
+    }
+}
+
+// 释放对象池的全部内存
+void slab_pool_destroy(SlabPool *pool) {
+    if (pool->base) {
+        munmap(pool->base, pool->region_size);
+    }
+    pool->base = NULL;
+    pool->free_list = NULL;
+    pool->capacity = 0;
+}
+
+// 内存类型名称
+const char* slab_page_type_name(SlabPageType type) {
+    return PAGE_TYPE_NAMES[type];
+}
@@ -0,0 +1,114 @@
+#include "timer_wheel.h"
+#include <stdlib.h>
+
+static void slot_insert(TimerWheel *wheel, TimerNode *node, long long tick) {
+    TimerNode *head = &wheel->slots[tick & (wheel->nr_slots - 1)];
+    node->slot_tick = tick;
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static void slot_remove(TimerNode *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = NULL;
+    node->next = NULL;
+}
+
+// 初始化时间轮
+int timer_wheel_init(TimerWheel *wheel, unsigned nr_slots, unsigned tick_us, long long now_us) {
+    unsigned n = 1;
+    while (n < nr_slots)
+        n <<= 1;
+    wheel->slots = malloc(n * sizeof(TimerNode));
+    if (!wheel->slots)
+        return -1;
+    for (unsigned i = 0; i < n; i++) {
+        wheel->slots[i].prev = &wheel->slots[i];
+        wheel->slots[i].next = &wheel->slots[i];
+    }
+    wheel->nr_slots = n;
+    wheel->tick_us = tick_us ? tick_us : 1;
+    wheel->now_tick = now_us / wheel->tick_us;
+    wheel->armed = 0;
+    return 0;
+}
+
+void timer_wheel_arm(TimerWheel *wheel, TimerNode *node, long long expires_us) {
+    // 向上取整，保证不会早于 expires_us 到期
+    long long expires = (expires_us + wheel->tick_us - 1) / wheel->tick_us;
+    if (expires <= wheel->now_tick)
+        expires = wheel->now_tick + 1;
+
+    if (timer_node_armed(node)) {
+        node->expires = expires;
+        // 推迟: 留在原槽位，轮到时再重排；提前: 必须换到更早的槽位
+        if (expires >= node->slot_tick)
+            return;
+        slot_remove(node);
+        wheel->armed--;
+    }
+    node->expires = expires;
+    slot_insert(wheel, node, expires);
+    wheel->armed++;
+}
+
+void timer_wheel_cancel(TimerWheel *wheel, TimerNode *node) {
+    if (!timer_node_armed(node))
+        return;
+    slot_remove(node);
+    wheel->armed--;
+}
+
+// 推进时间轮
+int timer_wheel_advance(TimerWheel *wheel, long long now_us, void (*expire)(TimerNode *node, void *arg), void *arg) {
+    long long target = now_us / wheel->tick_us;
+    if (target <= wheel->now_tick)
+        return 0;
+
+    // 落后超过一圈时每个槽位只需扫描一次
+    long long start = wheel->now_tick + 1;
+    if (target - wheel->now_tick > wheel->nr_slots)
+        start = target - wheel->nr_slots + 1;
+    // 先更新当前时间，回调中重新 arm 的节点以新时间为基准
+    wheel->now_tick = target;
+
+    int fired = 0;
+    for (long long tick = start; tick <= target; tick++) {
+        TimerNode *head = &wheel->slots[tick & (wheel->nr_slots - 1)];
+        if (head->next == head)
+            continue;
+        // 整个槽位摘成一条以 NULL 结尾的单链，处理过程中重新挂入同一槽位的节点不会被再次扫描
+        TimerNode *node = head->next;
+        head->prev->next = NULL;
+        head->prev = head;
+        head->next = head;
+
+        while (node) {
+            TimerNode *next = node->next;
+            if (node->expires <= target) {
+                node->prev = NULL;
+                node->next = NULL;
+                wheel->armed--;
+                expire(node, arg);
+                fired++;
+            } else if (node->slot_tick > target) {
+                // 超过一圈的定时器，留到后续轮次
+                slot_insert(wheel, node, node->slot_tick);
+            } else {
+                // 到期时间被推迟过，按新的到期时间重新挂入
+                slot_insert(wheel, node, node->expires);
+            }
+            node = next;
+        }
+    }
+    return fired;
+}
+
+void timer_wheel_destroy(TimerWheel *wheel) {
+    free(wheel->slots);
+    wheel->slots = NULL;
+    wheel->armed = 0;
+}
@@ -0,0 +1,344 @@
+#define _GNU_SOURCE
+#include "tls_session.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <linux/tls.h>
+#include <openssl/err.h>
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+#include <openssl/x509.h>
+
+#ifndef SOL_TLS
+#define SOL_TLS 282
+#endif
+#ifndef TCP_ULP
+#define TCP_ULP 31
+#endif
+
+#define TLS13_CIPHERSUITES "TLS_AES_128_GCM_SHA256:TLS_AES_256_GCM_SHA384"
+
+// 握手过程中由 keylog 回调记下的应用流量密钥 (挂在 SSL 的 ex_data 上)
+typedef struct {
+    unsigned char client[EVP_MAX_MD_SIZE];
+    unsigned char server[EVP_MAX_MD_SIZE];
+    size_t client_len;
+    size_t server_len;
+} TrafficSecrets;
+
+// 内核按套件区分的 crypto_info
+typedef union {
+    struct tls12_crypto_info_aes_gcm_128 gcm128;
+    struct tls12_crypto_info_aes_gcm_256 gcm256;
+} CryptoInfo;
+
+static int g_secrets_idx = -1;
+
+static void secrets_free(void *parent, void *ptr, CRYPTO_EX_DATA *ad, int idx, long argl, void *argp) {
+    (void)parent;
+    (void)ad;
+    (void)idx;
+    (void)argl;
+    (void)argp;
+    free(ptr);
+}
+
+static size_t hex_decode(const char *hex, unsigned char *out, size_t max) {
+    size_t n = 0;
+    while (n < max && hex[0] && hex[1]) {
+        unsigned int byte;
+        if (sscanf(hex, "%2x", &byte) != 1)
+            break;
+        out[n++] = byte;
+        hex += 2;
+    }
+    return n;
+}
+
+// keylog 行格式: "<标签> <client_random> <secret>"，只关心第 0 代应用流量密钥
+static void keylog_cb(const SSL *ssl, const char *line) {
+    int client = strncmp(line, "CLIENT_TRAFFIC_SECRET_0 ", 24) == 0;
+    int server = strncmp(line, "SERVER_TRAFFIC_SECRET_0 ", 24) == 0;
+    if (!client && !server)
+        return;
+    const char *secret = strrchr(line, ' ');
+    if (!secret)
+        return;
+
+    TrafficSecrets *ts = SSL_get_ex_data(ssl, g_secrets_idx);
+    if (!ts) {
+        ts = calloc(1, sizeof(TrafficSecrets));
+        if (!ts || !SSL_set_ex_data((SSL *)ssl, g_secrets_idx, ts)) {
+            free(ts);
+            return;
+        }
+    }
+    if (client)
+        ts->client_len = hex_decode(secret + 1, ts->client, sizeof(ts->client));
+    else
+        ts->server_len = hex_decode(secret + 1, ts->server, sizeof(ts->server));
+}
+
+static int ctx_setup(SSL_CTX *ctx, int ktls) {
+    if (!SSL_CTX_set_min_proto_version(ctx, TLS1_3_VERSION) || !SSL_CTX_set_ciphersuites(ctx, TLS13_CIPHERSUITES))
+        return -1;
+    if (ktls) {
+        if (g_secrets_idx < 0)
+            g_secrets_idx = SSL_get_ex_new_index(0, NULL, NULL, NULL, secrets_free);
+        if (g_secrets_idx < 0)
+            return -1;
+        SSL_CTX_set_keylog_callback(ctx, keylog_cb);
+    }
+    return 0;
+}
+
+// 临时自签名证书，只用于压测
+static int use_ephemeral_cert(SSL_CTX *ctx) {
+    int ret = -1;
+    EVP_PKEY *pkey = EVP_EC_gen("P-256");
+    X509 *x509 = X509_new();
+    if (!pkey || !x509)
+        goto out;
+
+    X509_set_version(x509, 2);
+    ASN1_INTEGER_set(X509_get_serialNumber(x509), 1);
+    X509_gmtime_adj(X509_getm_notBefore(x509), 0);
+    X509_gmtime_adj(X509_getm_notAfter(x509), 365L * 24 * 3600);
+    X509_set_pubkey(x509, pkey);
+    X509_NAME *name = X509_get_subject_name(x509);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char *)"tcp-echo-benchmark", -1, -1, 0);
+    X509_set_issuer_name(x509, name);
+    if (!X509_sign(x509, pkey, EVP_sha256()))
+        goto out;
+    if (SSL_CTX_use_certificate(ctx, x509) == 1 && SSL_CTX_use_PrivateKey(ctx, pkey) == 1)
+        ret = 0;
+out:
+    X509_free(x509);
+    EVP_PKEY_free(pkey);
+    return ret;
+}
+
+SSL_CTX* tls_session_server_ctx(const char *cert, const char *key, int ktls) {
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    if (!ctx)
+        return NULL;
+    if (ctx_setup(ctx, ktls) < 0)
+        goto fail;
+    // 会话票据是握手后额外发出的记录，会让服务端发送方向的记录序号不从 0 开始
+    SSL_CTX_set_num_tickets(ctx, 0);
+
+    if (cert) {
+        if (SSL_CTX_use_certificate_chain_file(ctx, cert) != 1 ||
+            SSL_CTX_use_PrivateKey_file(ctx, key ? key : cert, SSL_FILETYPE_PEM) != 1 ||
+            SSL_CTX_check_private_key(ctx) != 1)
+            goto fail;
+    } else if (use_ephemeral_cert(ctx) < 0) {
+        goto fail;
+    }
+    return ctx;
+fail:
+    SSL_CTX_free(ctx);
+    return NULL;
+}
+
+SSL_CTX* tls_session_client_ctx(int ktls) {
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    if (!ctx)
+        return NULL;
+    if (ctx_setup(ctx, ktls) < 0) {
+        SSL_CTX_free(ctx);
+        return NULL;
+    }
+    SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, NULL);
+    return ctx;
+}
+
+static long long now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+SSL* tls_session_new(SSL_CTX *ctx, int fd, int is_server) {
+    SSL *ssl = SSL_new(ctx);
+    if (!ssl)
+        return NULL;
+    if (!SSL_set_fd(ssl, fd)) {
+        SSL_free(ssl);
+        return NULL;
+    }
+    if (is_server)
+        SSL_set_accept_state(ssl);
+    else
+        SSL_set_connect_state(ssl);
+    return ssl;
+}
+
+int tls_session_handshake_step(SSL *ssl) {
+    // 错误队列是线程级的，上一次失败留下的错误会影响 SSL_get_error 的判断
+    ERR_clear_error();
+    int ret = SSL_do_handshake(ssl);
+    if (ret == 1)
+        return 0;
+    int err = SSL_get_error(ssl, ret);
+    if (err == SSL_ERROR_WANT_READ)
+        return POLLIN;
+    if (err == SSL_ERROR_WANT_WRITE)
+        return POLLOUT;
+    ERR_clear_error();
+    return -1;
+}
+
+SSL* tls_session_handshake(SSL_CTX *ctx, int fd, int is_server, int timeout_ms) {
+    SSL *ssl = tls_session_new(ctx, fd, is_server);
+    if (!ssl)
+        return NULL;
+
+    long long deadline = now_ms() + timeout_ms;
+    for (;;) {
+        int events = tls_session_handshake_step(ssl);
+        if (events == 0)
+            return ssl;
+        if (events < 0)
+            break;
+
+        long long left = deadline - now_ms();
+        if (left <= 0)
+            break;
+        struct pollfd pfd = {.fd = fd, .events = events};
+        if (poll(&pfd, 1, (int)left) < 0 && errno != EINTR)
+            break;
+    }
+    SSL_free(ssl);
+    return NULL;
+}
+
+// RFC 8446 7.1 HKDF-Expand-Label(secret, label, "", out_len)，out_len 不超过摘要长度，只需要 T(1)
+static int hkdf_expand_label(const EVP_MD *md, const unsigned char *secret, size_t secret_len, const char *label,
+                             unsigned char *out, size_t out_len) {
+    unsigned char info[64];
+    unsigned char block[EVP_MAX_MD_SIZE];
+    unsigned int block_len = 0;
+    size_t label_len = strlen(label);
+    size_t n = 0;
+
+    info[n++] = out_len >> 8;
+    info[n++] = out_len & 0xff;
+    info[n++] = 6 + label_len;
+    memcpy(info + n, "tls13 ", 6);
+    n += 6;
+    memcpy(info + n, label, label_len);
+    n += label_len;
+    info[n++] = 0;  // context 为空
+    info[n++] = 1;  // HKDF-Expand 计数器
+    if (!HMAC(md, secret, secret_len, info, n, block, &block_len) || block_len < out_len)
+        return -1;
+    memcpy(out, block, out_len);
+    return 0;
+}
+
+// 按套件填写内核的 crypto_info；rec_seq 保持为 0
+static int fill_crypto_info(const SSL_CIPHER *cipher, const unsigned char *secret, size_t secret_len,
+                            CryptoInfo *info, socklen_t *info_len) {
+    const EVP_MD *md = SSL_CIPHER_get_handshake_digest(cipher);
+    unsigned char key[32], iv[12];
+    size_t key_len;
+    int cipher_type;
+
+    switch (SSL_CIPHER_get_protocol_id(cipher)) {
+    case 0x1301:  // TLS_AES_128_GCM_SHA256
+        key_len = TLS_CIPHER_AES_GCM_128_KEY_SIZE;
+        cipher_type = TLS_CIPHER_AES_GCM_128;
+        *info_len = sizeof(info->gcm128);
+        break;
+    case 0x1302:  // TLS_AES_256_GCM_SHA384
+        key_len = TLS_CIPHER_AES_GCM_256_KEY_SIZE;
+        cipher_type = TLS_CIPHER_AES_GCM_256;
+        *info_len = sizeof(info->gcm256);
+        break;
+    default:
+        return -EOPNOTSUPP;
+    }
+    if (!md || hkdf_expand_label(md, secret, secret_len, "key", key, key_len) < 0 ||
+        hkdf_expand_label(md, secret, secret_len, "iv", iv, sizeof(iv)) < 0)
+        return -EINVAL;
+
+    // 12 字节 iv 的前 4 字节是 salt，后 8 字节与记录序号异或得到每条记录的 nonce
+    memset(info, 0, sizeof(*info));
+    if (cipher_type == TLS_CIPHER_AES_GCM_128) {
+        info->gcm128.info.version = TLS_1_3_VERSION;
+        info->gcm128.info.cipher_type = cipher_type;
+        memcpy(info->gcm128.key, key, key_len);
+        memcpy(info->gcm128.salt, iv, TLS_CIPHER_AES_GCM_128_SALT_SIZE);
+        memcpy(info->gcm128.iv, iv + TLS_CIPHER_AES_GCM_128_SALT_SIZE, TLS_CIPHER_AES_GCM_128_IV_SIZE);
+    } else {
+        info->gcm256.info.version = TLS_1_3_VERSION;
+        info->gcm256.info.cipher_type = cipher_type;
+        memcpy(info->gcm256.key, key, key_len);
+        memcpy(info->gcm256.salt, iv, TLS_CIPHER_AES_GCM_256_SALT_SIZE);
+        memcpy(info->gcm256.iv, iv + TLS_CIPHER_AES_GCM_256_SALT_SIZE, TLS_CIPHER_AES_GCM_256_IV_SIZE);
+    }
+    OPENSSL_cleanse(key, sizeof(key));
+    OPENSSL_cleanse(iv, sizeof(iv));
+    return 0;
+}
+
+int tls_session_install_ktls(SSL *ssl, int fd, int is_server) {
+    TrafficSecrets *ts = g_secrets_idx >= 0 ? SSL_get_ex_data(ssl, g_secrets_idx) : NULL;
+    if (!ts || !ts->client_len || !ts->server_len)
+        return -ENOKEY;
+    // SSL 已经从 socket 读走但尚未交付的数据在切换到内核后会丢失
+    if (SSL_has_pending(ssl))
+        return -EPROTO;
+
+    const SSL_CIPHER *cipher = SSL_get_current_cipher(ssl);
+    CryptoInfo tx, rx;
+    socklen_t tx_len, rx_len;
+    const unsigned char *tx_secret = is_server ? ts->server : ts->client;
+    const unsigned char *rx_secret = is_server ? ts->client : ts->server;
+    size_t tx_secret_len = is_server ? ts->server_len : ts->client_len;
+    size_t rx_secret_len = is_server ? ts->client_len : ts->server_len;
+
+    int ret = fill_crypto_info(cipher, tx_secret, tx_secret_len, &tx, &tx_len);
+    if (ret == 0)
+        ret = fill_crypto_info(cipher, rx_secret, rx_secret_len, &rx, &rx_len);
+    if (ret == 0) {
+        if (setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls")) < 0 ||
+            setsockopt(fd, SOL_TLS, TLS_TX, &tx, tx_len) < 0 || setsockopt(fd, SOL_TLS, TLS_RX, &rx, rx_len) < 0)
+            ret = -errno;
+    }
+    OPENSSL_cleanse(&tx, sizeof(tx));
+    OPENSSL_cleanse(&rx, sizeof(rx));
+    return ret;
+}
+
+int tls_session_use_memory_bio(SSL *ssl) {
+    BIO *rbio = BIO_new(BIO_s_mem());
+    BIO *wbio = BIO_new(BIO_s_mem());
+    if (!rbio || !wbio) {
+        BIO_free(rbio);
+        BIO_free(wbio);
+        return -1;
+    }
+    // 读完内存 BIO 中的密文时返回 WANT_READ 而不是 EOF
+    BIO_set_mem_eof_return(rbio, -1);
+    SSL_set_bio(ssl, rbio, wbio);
+    return 0;
+}
+
+int tls_session_ktls_available(void) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return 0;
+    int ret = setsockopt(fd, SOL_TCP, TCP_ULP, "tls", sizeof("tls"));
+    int available = ret == 0 || errno == ENOTCONN;
+    close(fd);
+    return available;
+}
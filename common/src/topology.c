@@ -0,0 +1,204 @@
+#define _GNU_SOURCE
+#include "topology.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+
+#define SYSFS_CPU "/sys/devices/system/cpu"
+#define SYSFS_NODE "/sys/devices/system/node"
+
+// set_mempolicy / mbind 的策略值 (linux/mempolicy.h)，不依赖 libnuma
+#define TOPO_MPOL_PREFERRED 1
+
+// 读取 sysfs 中的一行，去掉换行
+static int read_line(const char *path, char *buf, size_t size) {
+    FILE *fp = fopen(path, "r");
+    if (!fp)
+        return -1;
+    if (!fgets(buf, size, fp)) {
+        fclose(fp);
+        return -1;
+    }
+    fclose(fp);
+    buf[strcspn(buf, "\n")] = 0;
+    return 0;
+}
+
+static int read_int(const char *path, int fallback) {
+    char buf[32];
+    if (read_line(path, buf, sizeof(buf)) < 0)
+        return fallback;
+    return atoi(buf);
+}
+
+// 解析 CPU 列表
+int topology_parse_cpu_list(const char *list, cpu_set_t *set) {
+    CPU_ZERO(set);
+    const char *p = list;
+    while (*p) {
+        char *end;
+        long first = strtol(p, &end, 10);
+        long last = first;
+        if (end == p || first < 0)
+            return -1;
+        if (*end == '-') {
+            p = end + 1;
+            last = strtol(p, &end, 10);
+            if (end == p || last < first)
+                return -1;
+        }
+        if (last >= CPU_SETSIZE)
+            return -1;
+        for (long cpu = first; cpu <= last; cpu++)
+            CPU_SET(cpu, set);
+        if (*end == ',')
+            end++;
+        else if (*end != '\0')
+            return -1;
+        p = end;
+    }
+    return CPU_COUNT(set);
+}
+
+// 读取拓扑
+int topology_detect(Topology *topo) {
+    memset(topo, 0, sizeof(*topo));
+
+    char buf[4096];
+    cpu_set_t online;
+    if (read_line(SYSFS_CPU "/online", buf, sizeof(buf)) < 0 || topology_parse_cpu_list(buf, &online) <= 0) {
+        // 没有 sysfs (如部分容器) 时按 sysconf 报告的 CPU 数处理
+        CPU_ZERO(&online);
+        long n = sysconf(_SC_NPROCESSORS_ONLN);
+        for (long cpu = 0; cpu < n && cpu < TOPO_MAX_CPUS; cpu++)
+            CPU_SET(cpu, &online);
+    }
+
+    char path[256];
+    for (int cpu = 0; cpu < TOPO_MAX_CPUS && cpu < CPU_SETSIZE; cpu++) {
+        if (!CPU_ISSET(cpu, &online))
+            continue;
+        TopoCpu *c = &topo->cpus[topo->nr_cpus++];
+        c->cpu = cpu;
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/physical_package_id", cpu);
+        c->package = read_int(path, 0);
+        snprintf(path, sizeof(path), SYSFS_CPU "/cpu%d/topology/core_id", cpu);
+        c->core = read_int(path, cpu);
+    }
+    if (topo->nr_cpus == 0)
+        return -1;
+
+    // 节点: 逐个读取 nodeN/cpulist，目录不存在说明内核未开启 NUMA
+    topo->nr_nodes = 1;
+    for (int node = 0; node < TOPO_MAX_NODES; node++) {
+        snprintf(path, sizeof(path), SYSFS_NODE "/node%d/cpulist", node);
+        cpu_set_t set;
+        if (read_line(path, buf, sizeof(buf)) < 0 || topology_parse_cpu_list(buf, &set) < 0)
+            continue;
+        for (int i = 0; i < topo->nr_cpus; i++) {
+            if (CPU_ISSET(topo->cpus[i].cpu, &set))
+                topo->cpus[i].node = node;
+        }
+        if (node + 1 > topo->nr_nodes)
+            topo->nr_nodes = node + 1;
+    }
+
+    // SMT 序号: 同一 (封装, 物理核) 中按 CPU 编号排在前面的兄弟个数
+    for (int i = 0; i < topo->nr_cpus; i++) {
+        TopoCpu *c = &topo->cpus[i];
+        for (int j = 0; j < i; j++) {
+            if (topo->cpus[j].package == c->package && topo->cpus[j].core == c->core)
+                c->thread++;
+        }
+        if (c->thread == 0)
+            topo->nr_cores++;
+    }
+    return 0;
+}
+
+const TopoCpu* topology_cpu(const Topology *topo, int cpu) {
+    for (int i = 0; i < topo->nr_cpus; i++) {
+        if (topo->cpus[i].cpu == cpu)
+            return &topo->cpus[i];
+    }
+    return NULL;
+}
+
+// 生成 Worker 的 CPU 分配
+int topology_plan(const Topology *topo, const cpu_set_t *exclude, int first_node, int count, int *cpus) {
+    int order[TOPO_MAX_CPUS];
+    int avail = 0;
+
+    int max_thread = 0;
+    for (int i = 0; i < topo->nr_cpus; i++) {
+        if (topo->cpus[i].thread > max_thread)
+            max_thread = topo->cpus[i].thread;
+    }
+
+    // 节点顺序: first_node 排第一，其余按编号
+    int nodes[TOPO_MAX_NODES];
+    int nr_nodes = 0;
+    if (first_node >= 0 && first_node < topo->nr_nodes)
+        nodes[nr_nodes++] = first_node;
+    for (int node = 0; node < topo->nr_nodes; node++) {
+        if (node != first_node)
+            nodes[nr_nodes++] = node;
+    }
+
+    // 先排完所有物理核的第 0 个线程，再排第 1 个 SMT 兄弟，以此类推
+    char used[TOPO_MAX_CPUS] = {0};
+    for (int t = 0; t <= max_thread; t++) {
+        int placed;
+        do {
+            placed = 0;
+            // 轮流从各节点取一个 CPU；指定了 first_node 时每个节点取尽后再换下一个
+            for (int n = 0; n < nr_nodes; n++) {
+                for (int i = 0; i < topo->nr_cpus; i++) {
+                    const TopoCpu *c = &topo->cpus[i];
+                    if (used[i] || c->thread != t || c->node != nodes[n] || (exclude && CPU_ISSET(c->cpu, exclude)))
+                        continue;
+                    used[i] = 1;
+                    order[avail++] = c->cpu;
+                    placed = 1;
+                    if (first_node < 0)
+                        break;
+                }
+                if (first_node >= 0 && placed)
+                    break;
+            }
+        } while (placed);
+    }
+
+    if (avail == 0)
+        return 0;
+    for (int i = 0; i < count; i++)
+        cpus[i] = order[i % avail];
+    return avail;
+}
+
+int topology_nic_node(const char *ifname) {
+    char path[256];
+    snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", ifname);
+    return read_int(path, -1);
+}
+
+int topology_prefer_node(int node) {
+    if (node < 0 || node >= TOPO_MAX_NODES)
+        return -EINVAL;
+    unsigned long mask = 1UL << node;
+    if (syscall(SYS_set_mempolicy, TOPO_MPOL_PREFERRED, &mask, sizeof(mask) * 8) < 0)
+        return -errno;
+    return 0;
+}
+
+int topology_bind_memory(void *addr, size_t len, int node) {
+    if (node < 0 || node >= TOPO_MAX_NODES)
+        return -EINVAL;
+    unsigned long mask = 1UL << node;
+    if (syscall(SYS_mbind, addr, len, TOPO_MPOL_PREFERRED, &mask, sizeof(mask) * 8, 0) < 0)
+        return -errno;
+    return 0;
+}
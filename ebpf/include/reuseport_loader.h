@@ -0,0 +1,41 @@
+#ifndef REUSEPORT_LOADER_H
+#define REUSEPORT_LOADER_H
+
+#include <linux/types.h>
+#include "reuseport_shared.h"
+
+// SO_REUSEPORT 负载分派加载器句柄
+typedef struct reuseport_loader reuseport_loader_t;
+
+// 初始化加载器：加载 BPF 对象、写入分派参数并映射负载 map
+// 参数：bpf_obj_path - BPF 对象文件路径
+//       nr_workers - Worker 数 (不超过 REUSEPORT_MAX_WORKERS)
+//       prefer_syn_cpu - 是否优先选择收到 SYN 的 CPU 上的 Worker
+//       syn_cpu_slack - 本地 Worker 允许比最空闲 Worker 多出的负载
+// 返回：加载器句柄，失败返回 NULL
+reuseport_loader_t* reuseport_loader_init(const char *bpf_obj_path, int nr_workers, int prefer_syn_cpu,
+                                          unsigned syn_cpu_slack);
+
+// 登记 Worker 的监听 socket (必须已 listen)；第一个登记的 socket 同时挂载选择程序，对整个 reuseport 组生效
+// 返回：0 成功，-errno 失败
+int reuseport_loader_add_listener(reuseport_loader_t *loader, int worker, int listen_fd);
+
+// 登记 Worker 绑定的 CPU，供 prefer_syn_cpu 使用
+// 返回：0 成功，-1 失败
+int reuseport_loader_set_worker_cpu(reuseport_loader_t *loader, int worker, int cpu);
+
+// Worker 负载槽位 (mmap 到用户态，Worker 直接写入)
+struct reuseport_load* reuseport_loader_load_slot(reuseport_loader_t *loader, int worker);
+
+// 获取统计信息
+// 参数：least_loaded - 分派给最空闲 Worker 的次数（输出）
+//       syn_cpu - 分派给 SYN 所在 CPU 的 Worker 的次数（输出）
+//       fallback - 退回内核哈希的次数（输出）
+// 返回：0 成功，-1 失败
+int reuseport_loader_get_stats(reuseport_loader_t *loader, unsigned long long *least_loaded,
+                               unsigned long long *syn_cpu, unsigned long long *fallback);
+
+// 清理资源
+void reuseport_loader_destroy(reuseport_loader_t *loader);
+
+#endif // REUSEPORT_LOADER_H
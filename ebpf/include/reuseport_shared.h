@@ -0,0 +1,30 @@
+#ifndef REUSEPORT_SHARED_H
+#define REUSEPORT_SHARED_H
+
+// reuseport.bpf.c 与用户态加载器共用的 map 布局 (使用前需已定义 __u32/__u64)
+
+#define REUSEPORT_MAX_WORKERS 64
+#define REUSEPORT_MAX_CPUS 1024
+
+// 单个 Worker 的负载，独占一个缓存行，Worker 之间写入互不干扰
+struct reuseport_load {
+    __u32 active;  // 当前活跃连接数
+    __u32 queued;  // 最近一轮事件循环处理的事件数 (CQE / epoll 就绪事件)，反映 Worker 的忙碌程度
+    __u32 pad[14];
+};
+
+// 分派参数
+struct reuseport_config {
+    __u32 nr_workers;      // 参与分派的 Worker 数
+    __u32 prefer_syn_cpu;  // 优先选择收到 SYN 的 CPU 上的 Worker
+    __u32 syn_cpu_slack;   // 本地 Worker 负载最多可比最空闲的 Worker 高出多少
+    __u32 pad;
+};
+
+// 统计索引
+#define REUSEPORT_STAT_LEAST_LOADED 0  // 分派给负载最低的 Worker
+#define REUSEPORT_STAT_SYN_CPU 1       // 分派给收到 SYN 的 CPU 上的 Worker
+#define REUSEPORT_STAT_FALLBACK 2      // 选择失败，退回内核哈希
+#define REUSEPORT_STAT_MAX 3
+
+#endif // REUSEPORT_SHARED_H
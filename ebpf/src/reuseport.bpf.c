@@ -0,0 +1,159 @@
+// SPDX-License-Identifier: GPL-2.0
+/* SO_REUSEPORT 选择程序：新连接按各 Worker 的负载分派，而不是按四元组哈希盲分 */
+
+/* BPF helper 定义 */
+#define SEC(name) __attribute__((section(name), used))
+
+/* BPF 类型定义 */
+typedef unsigned char __u8;
+typedef unsigned short __u16;
+typedef unsigned int __u32;
+typedef unsigned long long __u64;
+
+/* BPF Map 类型 */
+enum bpf_map_type {
+    BPF_MAP_TYPE_ARRAY = 2,
+    BPF_MAP_TYPE_REUSEPORT_SOCKARRAY = 20,
+};
+
+#define BPF_F_MMAPABLE (1U << 10)
+
+/* BPF 辅助函数声明 */
+static void *(*bpf_map_lookup_elem)(void *map, const void *key) = (void *)1;
+static __u32 (*bpf_get_smp_processor_id)(void) = (void *)8;
+static long (*bpf_sk_select_reuseport)(void *reuse, void *map, void *key, __u64 flags) = (void *)82;
+
+/* BPF 程序返回值：SK_PASS 且未选中 socket 时内核退回默认的哈希选择 */
+#define SK_DROP 0
+#define SK_PASS 1
+
+/* Map 定义宏 */
+#define __uint(name, val) int(*name)[val]
+#define __type(name, val) typeof(val) *name
+
+/* SK_REUSEPORT 上下文 (只用到 hash，指针字段按 __bpf_md_ptr 占 8 字节) */
+struct sk_reuseport_md {
+    union {
+        void *data;
+        __u64 : 64;
+    } __attribute__((aligned(8)));
+    union {
+        void *data_end;
+        __u64 : 64;
+    } __attribute__((aligned(8)));
+    __u32 len;
+    __u32 eth_protocol;
+    __u32 ip_protocol;
+    __u32 bind_inany;
+    __u32 hash;
+};
+
+/* 原子操作 */
+#define __sync_fetch_and_add(ptr, val) __atomic_fetch_add(ptr, val, __ATOMIC_RELAXED)
+
+#include "reuseport_shared.h"
+
+// 每个 Worker 的监听 socket，下标为 Worker 编号
+struct {
+    __uint(type, BPF_MAP_TYPE_REUSEPORT_SOCKARRAY);
+    __uint(max_entries, REUSEPORT_MAX_WORKERS);
+    __type(key, __u32);
+    __type(value, __u32);
+} worker_socks SEC(".maps");
+
+// 每个 Worker 的负载，用户态 mmap 后由 Worker 直接写入，不需要系统调用
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, REUSEPORT_MAX_WORKERS);
+    __uint(map_flags, BPF_F_MMAPABLE);
+    __type(key, __u32);
+    __type(value, struct reuseport_load);
+} worker_load SEC(".maps");
+
+// CPU → Worker 编号 + 1 (0 表示该 CPU 上没有 Worker)
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, REUSEPORT_MAX_CPUS);
+    __type(key, __u32);
+    __type(value, __u32);
+} cpu_worker SEC(".maps");
+
+// 分派参数 (单元素)
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, 1);
+    __type(key, __u32);
+    __type(value, struct reuseport_config);
+} config SEC(".maps");
+
+// 统计信息
+struct {
+    __uint(type, BPF_MAP_TYPE_ARRAY);
+    __uint(max_entries, REUSEPORT_STAT_MAX);
+    __type(key, __u32);
+    __type(value, __u64);
+} stats SEC(".maps");
+
+static __attribute__((always_inline)) void stat_inc(__u32 key) {
+    __u64 *val = bpf_map_lookup_elem(&stats, &key);
+    if (val)
+        __sync_fetch_and_add(val, 1);
+}
+
+static __attribute__((always_inline)) __u32 worker_score(__u32 worker) {
+    struct reuseport_load *load = bpf_map_lookup_elem(&worker_load, &worker);
+    if (!load)
+        return (__u32)-1;
+    return load->active + load->queued;
+}
+
+// 选出负载最低的 Worker；从 hash 对应的位置开始扫描，负载相同时仍按哈希打散，避免突发连接全部落到 0 号
+SEC("sk_reuseport")
+int reuseport_select(struct sk_reuseport_md *reuse) {
+    __u32 zero = 0;
+    struct reuseport_config *cfg = bpf_map_lookup_elem(&config, &zero);
+    if (!cfg || cfg->nr_workers == 0 || cfg->nr_workers > REUSEPORT_MAX_WORKERS)
+        return SK_PASS;
+
+    __u32 nr = cfg->nr_workers;
+    __u32 start = reuse->hash % nr;
+    __u32 best = start;
+    __u32 best_score = (__u32)-1;
+    for (__u32 i = 0; i < REUSEPORT_MAX_WORKERS; i++) {
+        if (i >= nr)
+            break;
+        __u32 worker = start + i;
+        if (worker >= nr)
+            worker -= nr;
+        __u32 score = worker_score(worker);
+        if (score < best_score) {
+            best_score = score;
+            best = worker;
+        }
+    }
+
+    // 收到 SYN 的 CPU 上绑有 Worker 时优先交给它 (数据包与应用在同一核上处理)，只要它不比最空闲的多出 slack
+    __u32 target = best;
+    __u32 stat = REUSEPORT_STAT_LEAST_LOADED;
+    if (cfg->prefer_syn_cpu) {
+        __u32 cpu = bpf_get_smp_processor_id();
+        __u32 *slot = bpf_map_lookup_elem(&cpu_worker, &cpu);
+        if (slot && *slot > 0 && *slot <= nr) {
+            __u32 local = *slot - 1;
+            if (local == best || worker_score(local) <= best_score + cfg->syn_cpu_slack) {
+                target = local;
+                stat = REUSEPORT_STAT_SYN_CPU;
+            }
+        }
+    }
+
+    // Worker 的监听 socket 尚未加入 sockarray (启动中) 时选择失败，交给内核哈希
+    if (bpf_sk_select_reuseport(reuse, &worker_socks, &target, 0) != 0) {
+        stat_inc(REUSEPORT_STAT_FALLBACK);
+        return SK_PASS;
+    }
+    stat_inc(stat);
+    return SK_PASS;
+}
+
+char _license[] SEC("license") = "GPL";
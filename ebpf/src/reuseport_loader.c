@@ -0,0 +1,168 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <bpf/libbpf.h>
+#include <bpf/bpf.h>
+#include "reuseport_loader.h"
+
+#ifndef SO_ATTACH_REUSEPORT_EBPF
+#define SO_ATTACH_REUSEPORT_EBPF 52
+#endif
+
+struct reuseport_loader {
+    struct bpf_object *obj;
+    int prog_fd;
+    int map_socks_fd;       // REUSEPORT_SOCKARRAY fd
+    int map_cpu_fd;         // cpu_worker fd
+    int map_stats_fd;       // stats fd
+    struct reuseport_load *load;  // mmap 的 worker_load
+    size_t load_size;
+    int nr_workers;
+};
+
+static int find_map_fd(struct bpf_object *obj, const char *name) {
+    struct bpf_map *map = bpf_object__find_map_by_name(obj, name);
+    if (!map) {
+        fprintf(stderr, "Failed to find %s\n", name);
+        return -1;
+    }
+    return bpf_map__fd(map);
+}
+
+reuseport_loader_t *reuseport_loader_init(const char *bpf_obj_path, int nr_workers, int prefer_syn_cpu,
+                                          unsigned syn_cpu_slack) {
+    if (nr_workers <= 0 || nr_workers > REUSEPORT_MAX_WORKERS) {
+        fprintf(stderr, "reuseport: worker count %d out of range (1-%d)\n", nr_workers, REUSEPORT_MAX_WORKERS);
+        return NULL;
+    }
+
+    // 分配句柄
+    reuseport_loader_t *loader = calloc(1, sizeof(*loader));
+    if (!loader) {
+        fprintf(stderr, "Failed to allocate loader\n");
+        return NULL;
+    }
+    loader->nr_workers = nr_workers;
+
+    // 打开并加载 BPF 对象文件
+    struct bpf_object *obj = bpf_object__open(bpf_obj_path);
+    if (!obj) {
+        fprintf(stderr, "Failed to open BPF object: %s\n", bpf_obj_path);
+        free(loader);
+        return NULL;
+    }
+    loader->obj = obj;
+
+    int err = bpf_object__load(obj);
+    if (err) {
+        fprintf(stderr, "Failed to load BPF object: %d\n", err);
+        goto fail;
+    }
+
+    struct bpf_program *prog = bpf_object__find_program_by_name(obj, "reuseport_select");
+    if (!prog) {
+        fprintf(stderr, "Failed to find reuseport_select program\n");
+        goto fail;
+    }
+    loader->prog_fd = bpf_program__fd(prog);
+
+    loader->map_socks_fd = find_map_fd(obj, "worker_socks");
+    loader->map_cpu_fd = find_map_fd(obj, "cpu_worker");
+    loader->map_stats_fd = find_map_fd(obj, "stats");
+    int map_load_fd = find_map_fd(obj, "worker_load");
+    int map_config_fd = find_map_fd(obj, "config");
+    if (loader->map_socks_fd < 0 || loader->map_cpu_fd < 0 || loader->map_stats_fd < 0 || map_load_fd < 0 ||
+        map_config_fd < 0)
+        goto fail;
+
+    // 负载 map 映射到用户态 (需要 Linux >= 5.5 的 BPF_F_MMAPABLE)
+    long page_size = sysconf(_SC_PAGESIZE);
+    loader->load_size = (sizeof(struct reuseport_load) * REUSEPORT_MAX_WORKERS + page_size - 1) / page_size * page_size;
+    loader->load = mmap(NULL, loader->load_size, PROT_READ | PROT_WRITE, MAP_SHARED, map_load_fd, 0);
+    if (loader->load == MAP_FAILED) {
+        fprintf(stderr, "Failed to mmap worker_load: %s\n", strerror(errno));
+        loader->load = NULL;
+        goto fail;
+    }
+
+    __u32 key = 0;
+    struct reuseport_config cfg = {
+        .nr_workers = nr_workers,
+        .prefer_syn_cpu = prefer_syn_cpu ? 1 : 0,
+        .syn_cpu_slack = syn_cpu_slack,
+    };
+    err = bpf_map_update_elem(map_config_fd, &key, &cfg, BPF_ANY);
+    if (err) {
+        fprintf(stderr, "Failed to write reuseport config: %d\n", err);
+        goto fail;
+    }
+
+    printf("eBPF reuseport selector loaded successfully\n");
+    printf("  - prog fd: %d\n", loader->prog_fd);
+    printf("  - sockarray fd: %d\n", loader->map_socks_fd);
+    printf("  - workers: %d, prefer SYN CPU: %s\n", nr_workers, prefer_syn_cpu ? "yes" : "no");
+    return loader;
+
+fail:
+    reuseport_loader_destroy(loader);
+    return NULL;
+}
+
+int reuseport_loader_add_listener(reuseport_loader_t *loader, int worker, int listen_fd) {
+    if (!loader || worker < 0 || worker >= loader->nr_workers)
+        return -EINVAL;
+
+    // 程序挂在 reuseport 组上，每个 Worker 重复挂载同一个程序是幂等的，无需协调谁先挂
+    if (setsockopt(listen_fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_EBPF, &loader->prog_fd, sizeof(loader->prog_fd)) < 0)
+        return -errno;
+
+    __u32 key = worker;
+    __u32 value = listen_fd;
+    if (bpf_map_update_elem(loader->map_socks_fd, &key, &value, BPF_ANY) < 0)
+        return -errno;
+    return 0;
+}
+
+int reuseport_loader_set_worker_cpu(reuseport_loader_t *loader, int worker, int cpu) {
+    if (!loader || cpu < 0 || cpu >= REUSEPORT_MAX_CPUS)
+        return -1;
+
+    __u32 key = cpu;
+    __u32 value = worker + 1;
+    return bpf_map_update_elem(loader->map_cpu_fd, &key, &value, BPF_ANY) ? -1 : 0;
+}
+
+struct reuseport_load *reuseport_loader_load_slot(reuseport_loader_t *loader, int worker) {
+    if (!loader || worker < 0 || worker >= loader->nr_workers)
+        return NULL;
+    return &loader->load[worker];
+}
+
+int reuseport_loader_get_stats(reuseport_loader_t *loader, unsigned long long *least_loaded,
+                               unsigned long long *syn_cpu, unsigned long long *fallback) {
+    if (!loader)
+        return -1;
+
+    unsigned long long *out[REUSEPORT_STAT_MAX] = {least_loaded, syn_cpu, fallback};
+    for (__u32 key = 0; key < REUSEPORT_STAT_MAX; key++) {
+        __u64 val;
+        if (out[key] && bpf_map_lookup_elem(loader->map_stats_fd, &key, &val) == 0)
+            *out[key] = val;
+    }
+    return 0;
+}
+
+void reuseport_loader_destroy(reuseport_loader_t *loader) {
+    if (!loader)
+        return;
+
+    if (loader->load)
+        munmap(loader->load, loader->load_size);
+    if (loader->obj)
+        bpf_object__close(loader->obj);
+    free(loader);
+}
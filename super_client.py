@@ -116,12 +116,51 @@ def get_stats():
         print(f"❌ 解析响应失败: {response}")
         return None
 
+def get_history(seconds=None):
+    """获取最近若干秒的每秒速率 (server 控制线程每秒采样一次)"""
+    response = send_command("history" if seconds is None else f"history {seconds}")
+    if not response:
+        return None
+    try:
+        return json.loads(response).get("samples")
+    except json.JSONDecodeError:
+        return None
+
+def format_bytes(rate):
+    """字节/秒 → 可读字符串"""
+    for unit in ("B", "KB", "MB", "GB"):
+        if rate < 1024 or unit == "GB":
+            return f"{rate:.1f} {unit}/s"
+        rate /= 1024
+
+def print_rates(samples):
+    """打印最近一秒的速率与一分钟内的均值/峰值"""
+    if not samples:
+        return
+    last = samples[-1]
+    window = samples[-60:]
+    print("          每秒速率")
+    print("-"*50)
+    qps = [s["qps"] for s in window]
+    print(f"当前 QPS:       {last['qps']:.0f}  (近 {len(window)} 秒: 平均 {sum(qps) / len(qps):.0f} / 峰值 {max(qps):.0f})")
+    print(f"接收速率:       {format_bytes(last['rx_bps'])}")
+    print(f"发送速率:       {format_bytes(last['tx_bps'])}")
+    print(f"新建连接:       {last['conn_per_sec']:.1f} /s")
+    print("="*50 + "\n")
+
+def print_history(samples):
+    """按秒打印速率表"""
+    print(f"{'时间(s)':>8} {'QPS':>10} {'接收':>14} {'发送':>14} {'新建连接/s':>10} {'活跃连接':>8}")
+    for s in samples:
+        print(f"{s['t']:>8.1f} {s['qps']:>10.0f} {format_bytes(s['rx_bps']):>14} {format_bytes(s['tx_bps']):>14} "
+              f"{s['conn_per_sec']:>10.1f} {s['active']:>8}")
+
 def print_stats(stats):
     """打印统计信息"""
     if not stats:
         return
 
-    uptime_sec = stats.get("uptime_sec", 0)
+    uptime_sec = stats.get("uptime", 0)
     hours = uptime_sec // 3600
     minutes = (uptime_sec % 3600) // 60
     seconds = uptime_sec % 60
@@ -139,14 +178,14 @@ def print_stats(stats):
     print("-"*50)
 
     traffic = stats.get("traffic", {})
-    print(f"总请求数:       {traffic.get('total_requests', 0)}")
-    print(f"接收字节数:     {traffic.get('bytes_recv', 0)} ({traffic.get('bytes_recv', 0) / 1024 / 1024:.2f} MB)")
-    print(f"发送字节数:     {traffic.get('bytes_sent', 0)} ({traffic.get('bytes_sent', 0) / 1024 / 1024:.2f} MB)")
+    print(f"总请求数:       {traffic.get('requests', 0)}")
+    print(f"接收字节数:     {traffic.get('rx', 0)} ({traffic.get('rx', 0) / 1024 / 1024:.2f} MB)")
+    print(f"发送字节数:     {traffic.get('tx', 0)} ({traffic.get('tx', 0) / 1024 / 1024:.2f} MB)")
     print("-"*50)
 
     sys = stats.get("system", {})
-    print(f"CPU 使用率:     {sys.get('cpu_percent', 0):.2f}%")
-    print(f"内存 (RSS):     {sys.get('memory_rss_mb', 0):.2f} MB")
+    print(f"CPU 使用率:     {sys.get('cpu', 0):.2f}%")
+    print(f"内存 (RSS):     {sys.get('mem_mb', 0):.2f} MB")
     print(f"线程数:         {sys.get('threads', 0)}")
     print("="*50 + "\n")
 
@@ -166,6 +205,7 @@ def watch_stats(interval=2):
             stats = get_stats()
             if stats:
                 print_stats(stats)
+                print_rates(get_history(60))
             else:
                 print("❌ 无法获取统计信息")
                 break
@@ -187,13 +227,15 @@ TCP Echo Server 控制工具 (Super Client)
     stop        停止 server
     status      查看 server 状态
     stats       获取详细统计信息
-    watch       实时监控统计信息（默认 2 秒更新）
+    watch       实时监控统计信息与每秒速率（默认 2 秒更新）
+    history [N] 最近 N 秒的每秒 QPS / 字节 / 连接速率（默认 60，最多 600）
     restart     重启 server
 
 示例:
     python3 super_client.py start
     python3 super_client.py stats
     python3 super_client.py watch
+    python3 super_client.py history 30
     """)
 
 def main():
@@ -231,6 +273,17 @@ def main():
         else:
             sys.exit(1)
 
+    elif command == "history":
+        if not is_server_running():
+            print("❌ Server 未运行")
+            sys.exit(1)
+        samples = get_history(int(sys.argv[2]) if len(sys.argv) > 2 else None)
+        if samples is None:
+            print("❌ 无法获取历史速率")
+            sys.exit(1)
+        print_history(samples)
+        sys.exit(0)
+
     elif command == "watch":
         interval = int(sys.argv[2]) if len(sys.argv) > 2 else 2
         watch_stats(interval)